@@ -17,4 +17,9 @@ QColor colorDebug() {
     return c;
 }
 
+QColor colorSearchHit() {
+    static QColor c(255, 230, 0, 120);
+    return c;
+}
+
 } // namespace Appearance
@@ -8,6 +8,7 @@ namespace Appearance {
 QColor colorError();
 QColor colorWarning();
 QColor colorDebug();
+QColor colorSearchHit();
 
 } // namespace Appearance
 
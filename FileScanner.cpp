@@ -0,0 +1,149 @@
+#include "FileScanner.h"
+
+#include <QDir>
+#include <QHash>
+#include <QtConcurrent>
+
+namespace {
+
+QHash<QString, QVector<ScannedFile>>& scanCache()
+{
+    static QHash<QString, QVector<ScannedFile>> cache;
+    return cache;
+}
+
+QString cacheKey(const QString& dir, bool recursive)
+{
+    return QDir::cleanPath(dir) + (recursive ? "|r" : "|f");
+}
+
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+
+FileScanner::FileScanner(QObject *parent) : QObject(parent)
+{
+    // Listing directories mostly waits for the file system, especially a network one,
+    // so more tasks than cores are run at once
+    _pool.setMaxThreadCount(qMax(4, QThread::idealThreadCount() * 2));
+}
+
+FileScanner::~FileScanner()
+{
+    stop();
+    _pool.waitForDone();
+}
+
+bool FileScanner::cached(const QString& dir, bool recursive, QVector<ScannedFile>& files)
+{
+    auto it = scanCache().constFind(cacheKey(dir, recursive));
+    if (it == scanCache().constEnd()) return false;
+    files = it.value();
+    return true;
+}
+
+void FileScanner::start(const QString& dir, bool recursive)
+{
+    stop();
+
+    _dir = dir;
+    _recursive = recursive;
+    _found.clear();
+    _all.clear();
+
+    if (dir.isEmpty() || !QDir(dir).exists())
+    {
+        emit finished();
+        return;
+    }
+
+    _running = true;
+    TaskCounter tasks(new std::atomic<int>(1));
+    QtConcurrent::run(&_pool, this, &FileScanner::scanDir, QString(), dir, recursive, int(_generation), tasks);
+}
+
+void FileScanner::stop()
+{
+    // Outdated tasks see the changed generation and do not list their directories
+    QMutexLocker locker(&_pendingLock);
+    _generation++;
+    _pending.clear();
+    _running = false;
+}
+
+void FileScanner::scanDir(const QString& relative, const QString& root, bool recursive, int generation, TaskCounter tasks)
+{
+    if (_generation == generation)
+    {
+        QDir dir(relative.isEmpty() ? root : root + '/' + relative);
+        QString prefix = relative.isEmpty() ? QString() : relative + '/';
+
+        if (recursive)
+            for (const QString& sub : dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::NoSymLinks))
+            {
+                (*tasks)++;
+                QtConcurrent::run(&_pool, this, &FileScanner::scanDir, prefix + sub, root, recursive, generation, tasks);
+            }
+
+        QVector<ScannedFile> files;
+        for (const QFileInfo& info : dir.entryInfoList(QDir::Files))
+            files.append({prefix + info.fileName(), info.size()});
+
+        QMutexLocker locker(&_pendingLock);
+        if (_generation == generation)
+            _pending += files;
+    }
+
+    bool done = --(*tasks) == 0;
+    QMetaObject::invokeMethod(this, "takePending", Qt::QueuedConnection,
+                              Q_ARG(int, generation), Q_ARG(bool, done));
+}
+
+void FileScanner::takePending(int generation, bool done)
+{
+    QVector<ScannedFile> pending;
+    {
+        QMutexLocker locker(&_pendingLock);
+        if (generation != _generation) return;
+        pending.swap(_pending);
+    }
+    if (!pending.isEmpty())
+    {
+        _found += pending;
+        _all += pending;
+        emit filesFound();
+    }
+
+    if (done)
+    {
+        _running = false;
+        scanCache()[cacheKey(_dir, _recursive)] = _all;
+        _all.clear();
+        emit finished();
+    }
+}
+
+QVector<ScannedFile> FileScanner::takeFound()
+{
+    QVector<ScannedFile> found;
+    found.swap(_found);
+    return found;
+}
+
+QList<QRegExp> FileScanner::nameFilters(const QString& filter, Qt::CaseSensitivity cs)
+{
+    QList<QRegExp> filters;
+    for (const QString& glob : filter.split(QRegExp("[;\\s]+"), QString::SkipEmptyParts))
+        filters.append(QRegExp(glob, cs, QRegExp::Wildcard));
+    if (filters.isEmpty())
+        filters.append(QRegExp("*", cs, QRegExp::Wildcard));
+    return filters;
+}
+
+bool FileScanner::matches(const QList<QRegExp>& filters, const QString& name)
+{
+    for (const QRegExp& filter : filters)
+        if (filter.exactMatch(name))
+            return true;
+    return false;
+}
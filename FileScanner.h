@@ -0,0 +1,71 @@
+#ifndef FILE_SCANNER_H
+#define FILE_SCANNER_H
+
+#include <QMutex>
+#include <QObject>
+#include <QRegExp>
+#include <QThreadPool>
+#include <QVector>
+
+#include <atomic>
+#include <memory>
+
+struct ScannedFile
+{
+    QString path; ///< relative to the scanned directory
+    qint64 size;
+};
+
+/**
+    Lists files of a directory tree in a thread pool. Every directory is listed by a separate
+    task, so large and network-mounted trees are scanned in parallel. Found files are delivered
+    in portions while the scan is running. Results of complete scans are cached per directory.
+*/
+class FileScanner : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FileScanner(QObject *parent = 0);
+    ~FileScanner();
+
+    void start(const QString& dir, bool recursive);
+    void stop();
+    bool running() const { return _running; }
+
+    /// Takes files found since the last call.
+    QVector<ScannedFile> takeFound();
+
+    /// Files of the last complete scan of the directory. Returns false if it has not been scanned yet.
+    static bool cached(const QString& dir, bool recursive, QVector<ScannedFile>& files);
+
+    /// Wildcards of the filter separated by semicolons or spaces, '*' if there are none.
+    static QList<QRegExp> nameFilters(const QString& filter, Qt::CaseSensitivity cs);
+
+    /// Checks the file name without a path against the wildcards.
+    static bool matches(const QList<QRegExp>& filters, const QString& name);
+
+signals:
+    void filesFound();
+    void finished();
+
+private:
+    QThreadPool _pool;
+    QString _dir;
+    bool _recursive = false;
+    bool _running = false;
+    QVector<ScannedFile> _found, _all;
+
+    typedef std::shared_ptr<std::atomic<int>> TaskCounter;
+
+    std::atomic<int> _generation{0};
+    QMutex _pendingLock;
+    QVector<ScannedFile> _pending;
+
+    void scanDir(const QString& relative, const QString& root, bool recursive, int generation, TaskCounter tasks);
+
+private slots:
+    void takePending(int generation, bool done);
+};
+
+#endif // FILE_SCANNER_H
@@ -0,0 +1,91 @@
+#include "LineScanner.h"
+#include "Simd.h"
+
+#include <cstring>
+
+namespace {
+
+inline int trailingZeros(uint w)
+{
+#if defined(__GNUC__)
+    return __builtin_ctz(w);
+#else
+    int n = 0;
+    while (!(w & 1)) { w >>= 1; n++; }
+    return n;
+#endif
+}
+
+inline ushort unitAt(const char* data, int pos, LineScanner::Units units)
+{
+    auto b = reinterpret_cast<const uchar*>(data + pos);
+    return units == LineScanner::Utf16LE ? ushort(b[0] | (b[1] << 8)) : ushort((b[0] << 8) | b[1]);
+}
+
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+
+int LineScanner::scan(const char* data, int size, int from, QVector<int>& feeds) const
+{
+    int pos = from;
+    if (_units == Bytes)
+    {
+#ifdef LOGOTRON_SSE2
+        const __m128i lf = _mm_set1_epi8('\n');
+        for (; pos + 16 <= size; pos += 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+            uint mask = uint(_mm_movemask_epi8(_mm_cmpeq_epi8(v, lf)));
+            while (mask)
+            {
+                feeds.append(pos + trailingZeros(mask));
+                mask &= mask - 1;
+            }
+        }
+#endif
+        for (; pos < size; pos++)
+        {
+            auto p = static_cast<const char*>(std::memchr(data + pos, '\n', size_t(size - pos)));
+            if (!p) return size;
+            pos = int(p - data);
+            feeds.append(pos);
+        }
+        return size;
+    }
+
+    if (_units == Unsupported) return from;
+
+    const int end = size - (size - from) % 2;
+#ifdef LOGOTRON_SSE2
+    // Units are compared as 16-bit lanes as loaded on a little-endian CPU
+    const __m128i lf = _mm_set1_epi16(short(_units == Utf16LE ? 0x000A : 0x0A00));
+    for (; pos + 16 <= end; pos += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        uint mask = uint(_mm_movemask_epi8(_mm_cmpeq_epi16(v, lf)));
+        while (mask)
+        {
+            int bit = trailingZeros(mask);
+            feeds.append(pos + bit);
+            mask &= ~(3u << bit);
+        }
+    }
+#endif
+    for (; pos < end; pos += 2)
+        if (unitAt(data, pos, _units) == '\n')
+            feeds.append(pos);
+    return end;
+}
+
+int LineScanner::lineLength(const char* data, int start, int feed) const
+{
+    int len = feed - start;
+    if (_units == Bytes)
+    {
+        if (len > 0 && data[feed-1] == '\r') len--;
+    }
+    else if (len > 1 && unitAt(data, feed-2, _units) == '\r')
+        len -= 2;
+    return len;
+}
@@ -0,0 +1,38 @@
+#ifndef LINE_SCANNER_H
+#define LINE_SCANNER_H
+
+#include <QVector>
+
+/**
+    Finds line feeds in raw file bytes before they are decoded. Single byte line feeds
+    are searched 16 bytes at a time with SSE2, UTF-16 ones 8 code units at a time.
+*/
+class LineScanner
+{
+public:
+    /// How a line feed is encoded.
+    enum Units
+    {
+        Bytes,    ///< 0x0A byte never met inside other characters, UTF-8 and single-byte encodings
+        Utf16LE,  ///< 0x0A 0x00 at an even offset
+        Utf16BE,  ///< 0x00 0x0A at an even offset
+        Unsupported
+    };
+
+    explicit LineScanner(Units units) : _units(units) {}
+
+    Units units() const { return _units; }
+    int unitSize() const { return _units == Bytes ? 1 : 2; }
+
+    /// Appends offsets of line feeds in data[from, size) to the array, from must be at a unit boundary.
+    /// Returns the offset where the scan has stopped: an incomplete last unit is left for the next call.
+    int scan(const char* data, int size, int from, QVector<int>& feeds) const;
+
+    /// Length of the line ending at the line feed without a preceding carriage return.
+    int lineLength(const char* data, int start, int feed) const;
+
+private:
+    Units _units;
+};
+
+#endif // LINE_SCANNER_H
@@ -0,0 +1,165 @@
+#include "LogExporter.h"
+
+#include <QApplication>
+#include <QFile>
+#include <QtConcurrent>
+
+namespace {
+
+const int ChunkSize = 4096;
+
+void appendCsvField(QByteArray& out, const QString& s)
+{
+    QByteArray bytes = s.toUtf8();
+    if (bytes.indexOf('"') < 0 && bytes.indexOf(',') < 0 && bytes.indexOf('\n') < 0 && bytes.indexOf('\r') < 0)
+    {
+        out.append(bytes);
+        return;
+    }
+    out.append('"');
+    out.append(bytes.replace("\"", "\"\""));
+    out.append('"');
+}
+
+void appendJsonString(QByteArray& out, const QString& s)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    out.append('"');
+    for (char c : s.toUtf8())
+    {
+        switch (c)
+        {
+        case '"': out.append("\\\""); break;
+        case '\\': out.append("\\\\"); break;
+        case '\n': out.append("\\n"); break;
+        case '\r': out.append("\\r"); break;
+        case '\t': out.append("\\t"); break;
+        default:
+            if (uchar(c) < 0x20)
+            {
+                out.append("\\u00");
+                out.append(hex[uchar(c) >> 4]);
+                out.append(hex[uchar(c) & 0xF]);
+            }
+            else out.append(c);
+        }
+    }
+    out.append('"');
+}
+
+struct ChunkFormatter
+{
+    typedef QByteArray result_type;
+    const LogExporter* exporter;
+    QByteArray operator()(int start) const { return exporter->formatChunk(start); }
+};
+
+} // namespace
+
+LogExporter::LogExporter(const LogView& view, Format format) : _view(view), _format(format)
+{
+}
+
+QString LogExporter::exportTo(const QString& fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return file.errorString();
+
+    if (_format == Csv)
+        file.write("Num,Moment,Level,Header,Text\n");
+
+    // Each window holds a few chunks per thread; the next window is being formatted
+    // while the previous one is written, so formatting and disk writes overlap.
+    const int windowChunks = qMax(1, QThread::idealThreadCount()) * 2;
+    const int count = _view.count();
+
+    auto formatWindow = [this, count, windowChunks](int start) {
+        QVector<int> chunks;
+        for (int i = 0; i < windowChunks && start < count; i++, start += ChunkSize)
+            chunks.append(start);
+        return QtConcurrent::mapped(chunks, ChunkFormatter{this});
+    };
+
+    int start = 0;
+    auto current = formatWindow(start);
+    while (start < count)
+    {
+        int next = start + windowChunks * ChunkSize;
+        auto pending = formatWindow(next);
+
+        for (const QByteArray& chunk : current.results())
+        {
+            if (file.write(chunk) != chunk.size())
+            {
+                pending.waitForFinished();
+                QString error = file.errorString();
+                file.remove();
+                return error;
+            }
+        }
+        _exported = qMin(count, next);
+
+        if (_canceled)
+        {
+            pending.waitForFinished();
+            file.close();
+            file.remove();
+            return QString();
+        }
+        current = pending;
+        start = next;
+    }
+    if (file.flush()) return QString();
+    QString error = file.errorString();
+    file.remove();
+    return error;
+}
+
+QByteArray LogExporter::formatChunk(int start) const
+{
+    QByteArray out;
+    int end = qMin(start + ChunkSize, _view.count());
+    for (int i = start; i < end; i++)
+        formatItem(_view.at(i), out);
+    return out;
+}
+
+void LogExporter::formatItem(const LogItem* item, QByteArray& out) const
+{
+    switch (_format)
+    {
+    case PlainText:
+        out.append(item->content().toUtf8());
+        out.append('\n');
+        break;
+
+    case Csv:
+        out.append(QByteArray::number(item->number()));
+        out.append(',');
+        appendCsvField(out, item->moment);
+        out.append(',');
+        out.append(item->typeStr().toLatin1());
+        out.append(',');
+        appendCsvField(out, item->header);
+        out.append(',');
+        appendCsvField(out, item->content());
+        out.append('\n');
+        break;
+
+    case JsonLines:
+        out.append("{\"num\":");
+        out.append(QByteArray::number(item->number()));
+        out.append(",\"moment\":");
+        appendJsonString(out, item->moment);
+        out.append(",\"level\":\"");
+        out.append(item->typeStr().toLatin1());
+        out.append("\",\"header\":");
+        appendJsonString(out, item->header);
+        out.append(",\"text\":");
+        appendJsonString(out, item->content());
+        out.append("}\n");
+        break;
+    }
+}
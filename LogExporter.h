@@ -0,0 +1,39 @@
+#ifndef LOG_EXPORTER_H
+#define LOG_EXPORTER_H
+
+#include "LogItem.h"
+
+#include <atomic>
+
+/**
+    Writes records of a view into a file. Records are formatted in parallel chunks
+    and written in the original order, only a few chunks are kept in memory at once.
+*/
+class LogExporter
+{
+public:
+    enum Format { PlainText, Csv, JsonLines };
+
+    LogExporter(const LogView& view, Format format);
+
+    /// Returns an error message or an empty string on success. The file is removed on errors and cancel.
+    QString exportTo(const QString& fileName);
+
+    void cancel() { _canceled = true; }
+    bool canceled() const { return _canceled; }
+    int exportedCount() const { return _exported; }
+    int totalCount() const { return _view.count(); }
+
+    /// Formats a chunk of records starting from the given view position.
+    QByteArray formatChunk(int start) const;
+
+private:
+    LogView _view;
+    Format _format;
+    std::atomic<bool> _canceled{false};
+    std::atomic<int> _exported{0};
+
+    void formatItem(const LogItem* item, QByteArray& out) const;
+};
+
+#endif // LOG_EXPORTER_H
@@ -0,0 +1,420 @@
+#include "LogFields.h"
+
+#include <QApplication>
+
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+bool isFieldName(const QString& name)
+{
+    if (name.isEmpty() || !name.at(0).isLetter()) return false;
+    for (const QChar& c : name)
+        if (!c.isLetterOrNumber() && c != '_' && c != '.')
+            return false;
+    return true;
+}
+
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+
+bool LogFieldRule::extract(const QString& line, QString& value) const
+{
+    if (!literal.isEmpty() && !line.contains(literal)) return false;
+    if (regex.indexIn(line) < 0) return false;
+
+    value = regex.cap(1);
+    if (value.size() >= 2 && value.startsWith('"') && value.endsWith('"'))
+        value = value.mid(1, value.size() - 2);
+    return true;
+}
+
+QString LogFieldRule::parse(const QString& text, QVector<LogFieldRule>& rules)
+{
+    // Names of query predicates can not be taken by fields
+    static const QStringList reserved({"level", "text", "re", "regex", "header", "hre", "time"});
+
+    rules.clear();
+    QStringList lines = text.split('\n');
+    for (int i = 0; i < lines.size(); i++)
+    {
+        QString line = lines.at(i).trimmed();
+        if (line.isEmpty() || line.startsWith('#')) continue;
+
+        auto error = [i](const QString& message) { return qApp->tr("Line %1: %2").arg(i + 1).arg(message); };
+
+        int eq = line.indexOf('=');
+        if (eq < 0)
+            return error(qApp->tr("'=' expected"));
+
+        LogFieldRule rule;
+        QString name = line.left(eq).trimmed();
+        int colon = name.indexOf(':');
+        if (colon >= 0)
+        {
+            QString type = name.mid(colon + 1).trimmed().toLower();
+            name = name.left(colon).trimmed();
+            if (type == "int") rule.type = Int;
+            else if (type == "double") rule.type = Double;
+            else if (type == "string") rule.type = String;
+            else return error(qApp->tr("Unknown type '%1'").arg(type));
+        }
+        if (!isFieldName(name))
+            return error(qApp->tr("Invalid field name '%1'").arg(name));
+        rule.name = name.toLower();
+        if (reserved.contains(rule.name))
+            return error(qApp->tr("Name '%1' is reserved").arg(name));
+        for (const LogFieldRule& r : rules)
+            if (r.name == rule.name)
+                return error(qApp->tr("Duplicate field '%1'").arg(name));
+
+        QString source = line.mid(eq + 1).trimmed();
+        if (source.startsWith("re:"))
+        {
+            rule.regex = QRegExp(source.mid(3));
+            if (!rule.regex.isValid())
+                return error(qApp->tr("Invalid regular expression: %1").arg(rule.regex.errorString()));
+            if (rule.regex.captureCount() < 1)
+                return error(qApp->tr("Regular expression must capture the value in a group"));
+        }
+        else if (source.startsWith("key:"))
+        {
+            rule.literal = source.mid(4).trimmed();
+            if (rule.literal.isEmpty())
+                return error(qApp->tr("Key is empty"));
+            rule.regex = QRegExp("(?:^|[^\\w])" + QRegExp::escape(rule.literal) + "\\s*[=:]\\s*(\"[^\"]*\"|[^\\s,;]+)");
+        }
+        else
+            return error(qApp->tr("'re:' or 'key:' expected"));
+
+        rules.append(rule);
+    }
+    return QString();
+}
+
+QString LogFieldRule::typeName(Type type)
+{
+    switch (type)
+    {
+    case Int: return "int";
+    case Double: return "double";
+    case String: return "string";
+    }
+    return QString();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+constexpr qint64 LogFieldColumn::NoInt;
+
+int LogFieldColumn::size() const
+{
+    switch (type)
+    {
+    case LogFieldRule::Int: return ints.size();
+    case LogFieldRule::Double: return doubles.size();
+    case LogFieldRule::String: return strings.size();
+    }
+    return 0;
+}
+
+bool LogFieldColumn::has(int row) const
+{
+    switch (type)
+    {
+    case LogFieldRule::Int: return ints.at(row) != NoInt;
+    case LogFieldRule::Double: return !std::isnan(doubles.at(row));
+    case LogFieldRule::String: return strings.at(row) >= 0;
+    }
+    return false;
+}
+
+qint64 LogFieldColumn::bytes() const
+{
+    return ints.capacity() * qint64(sizeof(qint64)) +
+           doubles.capacity() * qint64(sizeof(double)) +
+           strings.capacity() * qint64(sizeof(int));
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void LogFields::setRules(const QVector<LogFieldRule>& rules)
+{
+    _columns.clear();
+    for (const LogFieldRule& rule : rules)
+    {
+        LogFieldColumn column;
+        column.name = rule.name;
+        column.type = rule.type;
+        _columns.append(column);
+    }
+    _keyColumn = -1;
+    _keyIndex.clear();
+    _keyRows = 0;
+}
+
+void LogFields::setKeyColumn(int column)
+{
+    _keyColumn = column >= 0 && column < _columns.size() ? column : -1;
+    rebuildKeyIndex();
+}
+
+QVector<int> LogFields::related(int row) const
+{
+    qint64 key;
+    if (!keyOf(row, key)) return QVector<int>();
+    return _keyIndex.value(key);
+}
+
+/**
+    Value of the key column as an integer: string ids, integers or bits of doubles.
+*/
+bool LogFields::keyOf(int row, qint64& key) const
+{
+    if (_keyColumn < 0) return false;
+    const LogFieldColumn& c = _columns.at(_keyColumn);
+    if (row < 0 || row >= c.size() || !c.has(row)) return false;
+    switch (c.type)
+    {
+    case LogFieldRule::Int:
+        key = c.ints.at(row);
+        break;
+    case LogFieldRule::Double:
+    {
+        double d = c.doubles.at(row);
+        if (d == 0) d = 0; // negative zero equals zero
+        std::memcpy(&key, &d, sizeof(key));
+        break;
+    }
+    case LogFieldRule::String:
+        key = c.strings.at(row);
+        break;
+    }
+    return true;
+}
+
+/**
+    Rows are stored in ascending order, so lists of the index stay sorted by appending.
+*/
+void LogFields::indexRow(int column, int row)
+{
+    if (column != _keyColumn) return;
+    qint64 key;
+    if (!keyOf(row, key)) return;
+    QVector<int>& rows = _keyIndex[key];
+    if (rows.isEmpty() || rows.last() < row)
+    {
+        rows.append(row);
+        _keyRows++;
+    }
+}
+
+void LogFields::rebuildKeyIndex()
+{
+    _keyIndex.clear();
+    _keyRows = 0;
+    if (_keyColumn < 0) return;
+    int count = _columns.at(_keyColumn).size();
+    for (int row = 0; row < count; row++)
+        indexRow(_keyColumn, row);
+}
+
+int LogFields::indexOf(const QString& name) const
+{
+    for (int i = 0; i < _columns.size(); i++)
+        if (_columns.at(i).name == name)
+            return i;
+    return -1;
+}
+
+QStringList LogFields::names() const
+{
+    QStringList names;
+    for (const LogFieldColumn& column : _columns)
+        names << column.name;
+    return names;
+}
+
+void LogFields::appendRow()
+{
+    for (LogFieldColumn& column : _columns)
+        switch (column.type)
+        {
+        case LogFieldRule::Int: column.ints.append(LogFieldColumn::NoInt); break;
+        case LogFieldRule::Double: column.doubles.append(std::numeric_limits<double>::quiet_NaN()); break;
+        case LogFieldRule::String: column.strings.append(-1); break;
+        }
+}
+
+void LogFields::set(int column, int row, const QString& value)
+{
+    LogFieldColumn& c = _columns[column];
+    bool ok = false;
+    switch (c.type)
+    {
+    case LogFieldRule::Int:
+    {
+        qint64 v = value.toLongLong(&ok);
+        if (ok && v != LogFieldColumn::NoInt) c.ints[row] = v;
+        break;
+    }
+    case LogFieldRule::Double:
+    {
+        double v = value.toDouble(&ok);
+        if (ok) c.doubles[row] = v;
+        break;
+    }
+    case LogFieldRule::String:
+    {
+        QString s(value);
+        c.strings[row] = _strings->intern(s);
+        break;
+    }
+    }
+    indexRow(column, row);
+}
+
+void LogFields::copyRow(const QVector<LogFieldColumn>& from, int fromRow, int toRow)
+{
+    for (int i = 0; i < _columns.size() && i < from.size(); i++)
+    {
+        LogFieldColumn& c = _columns[i];
+        const LogFieldColumn& f = from.at(i);
+        switch (c.type)
+        {
+        case LogFieldRule::Int: c.ints[toRow] = f.ints.at(fromRow); break;
+        case LogFieldRule::Double: c.doubles[toRow] = f.doubles.at(fromRow); break;
+        case LogFieldRule::String: c.strings[toRow] = f.strings.at(fromRow); break;
+        }
+        indexRow(i, toRow);
+    }
+}
+
+void LogFields::copyRow(const LogFields& from, int fromRow, int toRow)
+{
+    for (int i = 0; i < _columns.size() && i < from.count(); i++)
+    {
+        LogFieldColumn& c = _columns[i];
+        const LogFieldColumn& f = from.column(i);
+        switch (c.type)
+        {
+        case LogFieldRule::Int: c.ints[toRow] = f.ints.at(fromRow); break;
+        case LogFieldRule::Double: c.doubles[toRow] = f.doubles.at(fromRow); break;
+        case LogFieldRule::String:
+        {
+            int id = f.strings.at(fromRow);
+            if (id < 0) break;
+            QString s(from.strings().string(id));
+            c.strings[toRow] = _strings->intern(s);
+            break;
+        }
+        }
+        indexRow(i, toRow);
+    }
+}
+
+QVector<LogFieldColumn> LogFields::takeRows()
+{
+    QVector<LogFieldColumn> rows = _columns;
+    for (LogFieldColumn& column : _columns)
+    {
+        column.ints.clear();
+        column.doubles.clear();
+        column.strings.clear();
+    }
+    _keyIndex.clear();
+    _keyRows = 0;
+    return rows;
+}
+
+void LogFields::removeFirstRows(int count)
+{
+    for (LogFieldColumn& column : _columns)
+    {
+        if (!column.ints.isEmpty()) column.ints.remove(0, qMin(count, column.ints.size()));
+        if (!column.doubles.isEmpty()) column.doubles.remove(0, qMin(count, column.doubles.size()));
+        if (!column.strings.isEmpty()) column.strings.remove(0, qMin(count, column.strings.size()));
+    }
+    rebuildKeyIndex();
+}
+
+bool LogFields::compactStrings()
+{
+    const int poolCount = _strings->count();
+    QVector<int> newIds(poolCount, -1);
+    int used = 0;
+    for (const LogFieldColumn& column : _columns)
+        for (int id : column.strings)
+            if (id >= 0 && newIds.at(id) < 0)
+            {
+                newIds[id] = 0;
+                used++;
+            }
+    if (used * 2 >= poolCount) return false;
+
+    QScopedPointer<StringPool> strings(new StringPool);
+    newIds.fill(-1);
+    for (LogFieldColumn& column : _columns)
+        for (int& id : column.strings)
+            if (id >= 0)
+            {
+                if (newIds.at(id) < 0)
+                {
+                    QString s(_strings->string(id));
+                    newIds[id] = strings->intern(s);
+                }
+                id = newIds.at(id);
+            }
+    _strings.swap(strings);
+    rebuildKeyIndex();
+    return true;
+}
+
+qint64 LogFields::rowBytes(int row) const
+{
+    qint64 bytes = 0;
+    for (const LogFieldColumn& c : _columns)
+        switch (c.type)
+        {
+        case LogFieldRule::Int: bytes += sizeof(qint64); break;
+        case LogFieldRule::Double: bytes += sizeof(double); break;
+        case LogFieldRule::String:
+            bytes += sizeof(int);
+            if (c.has(row)) bytes += StringPool::bytes(_strings->string(c.strings.at(row)));
+            break;
+        }
+    // A row of the key index and a key of its own at worst
+    if (_keyColumn >= 0 && _columns.at(_keyColumn).has(row))
+        bytes += sizeof(int) + sizeof(qint64) + sizeof(QVector<int>);
+    return bytes;
+}
+
+QVariant LogFields::value(int column, int row) const
+{
+    const LogFieldColumn& c = _columns.at(column);
+    if (!c.has(row)) return QVariant();
+    switch (c.type)
+    {
+    case LogFieldRule::Int: return c.ints.at(row);
+    case LogFieldRule::Double: return c.doubles.at(row);
+    case LogFieldRule::String: return _strings->string(c.strings.at(row));
+    }
+    return QVariant();
+}
+
+QString LogFields::text(int column, int row) const
+{
+    return value(column, row).toString();
+}
+
+qint64 LogFields::memoryUsage() const
+{
+    qint64 bytes = _strings->memoryUsage();
+    for (const LogFieldColumn& column : _columns)
+        bytes += column.bytes();
+    // The index is estimated by its sizes, it is not walked as received records update it often
+    bytes += _keyIndex.size() * qint64(sizeof(qint64) + sizeof(QVector<int>)) + _keyRows * qint64(sizeof(int));
+    return bytes;
+}
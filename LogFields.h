@@ -0,0 +1,137 @@
+#ifndef LOG_FIELDS_H
+#define LOG_FIELDS_H
+
+#include <QHash>
+#include <QRegExp>
+#include <QScopedPointer>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+
+#include <limits>
+
+#include "StringPool.h"
+
+/**
+    Rule extracting a named value from lines of records. Rules are written one per line:
+
+        name[:type] = re:<regular expression capturing the value in the first group>
+        name[:type] = key:<key of a 'key=value' or 'key: value' pair>
+
+    The type is int, double or string, string is the default. Lines starting with # are comments.
+*/
+struct LogFieldRule
+{
+    enum Type { Int, Double, String };
+
+    QString name;
+    Type type = String;
+    QRegExp regex;
+    QString literal; ///< text every matching line contains, it is checked before the regex
+
+    /// Finds the value in the line. Quotes around the value are removed.
+    bool extract(const QString& line, QString& value) const;
+
+    /// Parses rules written one per line. Returns an error message or an empty string on success.
+    static QString parse(const QString& text, QVector<LogFieldRule>& rules);
+
+    static QString typeName(Type type);
+};
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+    Values of a field for all records of a store, stored by record index
+    in the vector of the field type. Missing values are NoInt, NaN or -1 for strings.
+*/
+struct LogFieldColumn
+{
+    static constexpr qint64 NoInt = std::numeric_limits<qint64>::min();
+
+    QString name;
+    LogFieldRule::Type type = LogFieldRule::String;
+    QVector<qint64> ints;
+    QVector<double> doubles;
+    QVector<int> strings; ///< ids in the string pool of the fields
+
+    int size() const;
+    bool has(int row) const;
+    qint64 bytes() const;
+};
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+    Typed columns of fields extracted from records of a store.
+    Rows are added with records, string values are interned.
+
+    Values of the key column are indexed while they are stored: the index maps
+    every value to the rows having it, so records related by the key are found
+    in the time proportional to their number.
+*/
+class LogFields
+{
+public:
+    LogFields() : _strings(new StringPool) {}
+
+    void setRules(const QVector<LogFieldRule>& rules);
+
+    /// Makes the column the correlation key, -1 disables it. It must be set before rows are added.
+    void setKeyColumn(int column);
+    int keyColumn() const { return _keyColumn; }
+
+    /// Rows having the same key value as the row in ascending order, empty if the row has no key.
+    QVector<int> related(int row) const;
+
+    int count() const { return _columns.size(); }
+    const LogFieldColumn& column(int i) const { return _columns.at(i); }
+    int indexOf(const QString& name) const;
+    QStringList names() const;
+
+    void appendRow();
+
+    /// Converts the text to the type of the column and stores it, values that do not convert are ignored.
+    void set(int column, int row, const QString& value);
+
+    /// Copies values of a row of columns taken from the fields before.
+    void copyRow(const QVector<LogFieldColumn>& from, int fromRow, int toRow);
+
+    /// Copies values of a row of other fields of the same schema, strings are interned here.
+    void copyRow(const LogFields& from, int fromRow, int toRow);
+
+    /// Removes all rows returning the columns, the schema and the string pool are kept.
+    QVector<LogFieldColumn> takeRows();
+
+    void removeFirstRows(int count);
+
+    /// Starts the string pool over, it is only valid when there are no rows.
+    void resetStrings() { _strings.reset(new StringPool); }
+
+    /// Moves values of the rows into a new pool when most pooled strings are not used
+    /// by rows anymore, e.g. after the first rows are removed. Returns true if it has.
+    bool compactStrings();
+
+    /// Approximate memory taken by values of the row, pooled strings are counted as if not shared.
+    qint64 rowBytes(int row) const;
+
+    QVariant value(int column, int row) const;
+    QString text(int column, int row) const;
+
+    const StringPool& strings() const { return *_strings; }
+    qint64 memoryUsage() const;
+
+private:
+    QVector<LogFieldColumn> _columns;
+    QScopedPointer<StringPool> _strings;
+    int _keyColumn = -1;
+    QHash<qint64, QVector<int>> _keyIndex;
+    int _keyRows = 0; ///< rows in all lists of the index
+
+    bool keyOf(int row, qint64& key) const;
+    void indexRow(int column, int row);
+    void rebuildKeyIndex();
+
+    Q_DISABLE_COPY(LogFields)
+};
+
+#endif // LOG_FIELDS_H
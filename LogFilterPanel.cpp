@@ -1,4 +1,5 @@
 #include "LogFilterPanel.h"
+#include "LogQuery.h"
 
 #include "helpers/OriWidgets.h"
 #include "helpers/OriDialogs.h"
@@ -12,6 +13,7 @@
 #include <QGroupBox>
 #include <QInputDialog>
 #include <QLabel>
+#include <QLineEdit>
 #include <QMenu>
 #include <QPlainTextEdit>
 #include <QPushButton>
@@ -128,8 +130,57 @@ LogFilterPanel::LogFilterPanel(QWidget *parent) : QWidget(parent)
         headerLabel(tr("Exclude")),
         _excludingFilters = new QVBoxLayout,
         Ori::Gui::button(tr("Append..."), this, SLOT(appendExcludingFilter())),
+        Space(6),
+        headerLabel(tr("Query")),
+        _customQuery = new QLineEdit,
+        _queryError = new QLabel,
+        _expression = new QLabel,
+        Space(6),
+        _statistics = new QLabel,
         Stretch(),
     }).useFor(this);
+
+    Ori::Gui::setFontMonospace(_customQuery);
+    _customQuery->setPlaceholderText(tr("e.g. header:connect OR re:\"id=\\d+\""));
+    _customQuery->setToolTip(tr("Combine level:, text:, re:, header:, hre: and time predicates "
+                                "with AND, OR, NOT and parentheses. Press Enter to apply.\n"
+                                "Extracted fields are compared by name, e.g. duration>150."));
+    connect(_customQuery, SIGNAL(returnPressed()), this, SLOT(applyCustomQuery()));
+
+    _queryError->setStyleSheet("color: red");
+    _queryError->setWordWrap(true);
+    _queryError->setVisible(false);
+
+    Ori::Gui::setFontMonospace(_expression);
+    _expression->setWordWrap(true);
+    _expression->setTextInteractionFlags(Qt::TextSelectableByMouse);
+    _expression->setForegroundRole(QPalette::Dark);
+
+    Ori::Gui::setFontMonospace(_statistics);
+    _statistics->setTextInteractionFlags(Qt::TextSelectableByMouse);
+    _statistics->setToolTip(tr("Predicates in the order of evaluation. Calls and passes are counted "
+                               "in the last filtering pass, time is sampled for every %1th record. "
+                               "The order is tuned with these measurements for the next pass.")
+                            .arg(int(LogQueryStats::SampleEvery)));
+    _statistics->setVisible(false);
+
+    _filters.update();
+    _expression->setText(_filters.expression());
+    _expression->setToolTip(_filters.query()->describe());
+}
+
+void LogFilterPanel::showStatistics()
+{
+    QString report = _filters.query()->statsReport();
+    _statistics->setText(report);
+    _statistics->setVisible(!report.isEmpty());
+    _expression->setToolTip(_filters.query()->describe());
+}
+
+void LogFilterPanel::applyCustomQuery()
+{
+    _filters.setCustomQuery(_customQuery->text());
+    raiseChanged();
 }
 
 LogItemTypeFilterView* LogFilterPanel::makeItemTypeFilter(LogItem::Type type, const QString& title)
@@ -141,9 +192,28 @@ LogItemTypeFilterView* LogFilterPanel::makeItemTypeFilter(LogItem::Type type, co
     return view;
 }
 
+void LogFilterPanel::setFields(const LogFields* fields)
+{
+    _filters.setFields(fields);
+    compile();
+}
+
+bool LogFilterPanel::compile()
+{
+    QString error = _filters.update();
+    _queryError->setText(error);
+    _queryError->setVisible(!error.isEmpty());
+    if (!error.isEmpty()) return false;
+
+    _expression->setText(_filters.expression());
+    _expression->setToolTip(_filters.query()->describe());
+    return true;
+}
+
 void LogFilterPanel::raiseChanged()
 {
-    emit changed();
+    if (compile())
+        emit changed();
 }
 
 void LogFilterPanel::appendExcludingFilter()
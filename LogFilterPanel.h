@@ -7,6 +7,7 @@
 
 QT_BEGIN_NAMESPACE
 class QLabel;
+class QLineEdit;
 class QMenu;
 class QVBoxLayout;
 QT_END_NAMESPACE
@@ -73,17 +74,27 @@ public:
 
     const LogFilters* filters() const { return &_filters; }
 
+    /// Shows measurements of the last filtering pass.
+    void showStatistics();
+
+    /// Fields of the opened dataset that can be used in the query, the query is compiled again.
+    void setFields(const LogFields* fields);
+
 signals:
     void changed();
 
 private:
     LogFilters _filters;
     QVBoxLayout *_excludingFilters, *_searchingFilters;
+    QLineEdit *_customQuery;
+    QLabel *_queryError, *_expression, *_statistics;
 
     LogItemTypeFilterView* makeItemTypeFilter(LogItem::Type type, const QString& title);
+    bool compile();
 
 private slots:
     void raiseChanged();
+    void applyCustomQuery();
     void appendExcludingFilter();
     void appendSearchingFilter();
     void removeTextFilter(LogItemTextFilterView*);
@@ -0,0 +1,85 @@
+#include "LogFindBar.h"
+
+#include "helpers/OriLayouts.h"
+#include "helpers/OriWidgets.h"
+
+#include <QCheckBox>
+#include <QKeyEvent>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QTimer>
+
+using namespace Ori::Layouts;
+
+LogFindBar::LogFindBar(QWidget *parent) : QWidget(parent)
+{
+    _text = new QLineEdit;
+    _text->setPlaceholderText(tr("Find in records"));
+    Ori::Gui::setFontMonospace(_text);
+
+    _useRegex = new QCheckBox(tr("Regex"));
+    _status = new QLabel;
+
+    // Searching starts when typing pauses, not on every key stroke
+    _searchTimer = new QTimer(this);
+    _searchTimer->setSingleShot(true);
+    _searchTimer->setInterval(300);
+    connect(_searchTimer, SIGNAL(timeout()), this, SIGNAL(searchChanged()));
+    connect(_text, SIGNAL(textChanged(QString)), _searchTimer, SLOT(start()));
+    connect(_text, SIGNAL(returnPressed()), this, SIGNAL(findNext()));
+    connect(_useRegex, SIGNAL(toggled(bool)), this, SIGNAL(searchChanged()));
+
+    LayoutH({
+                _text,
+                _useRegex,
+                Ori::Gui::button(tr("Previous"), this, SIGNAL(findPrevious())),
+                Ori::Gui::button(tr("Next"), this, SIGNAL(findNext())),
+                _status,
+                Stretch(),
+                Ori::Gui::button(tr("Close"), this, SLOT(closeBar())),
+            }).setMargin(0).useFor(this);
+}
+
+QString LogFindBar::text() const
+{
+    return _text->text();
+}
+
+bool LogFindBar::useRegex() const
+{
+    return _useRegex->isChecked();
+}
+
+void LogFindBar::activate()
+{
+    setVisible(true);
+    _text->setFocus();
+    _text->selectAll();
+}
+
+void LogFindBar::showStatus(int hitCount, bool running)
+{
+    if (_text->text().isEmpty())
+        _status->clear();
+    else if (running)
+        _status->setText(tr("Found: %1 (searching...)").arg(hitCount));
+    else
+        _status->setText(tr("Found: %1").arg(hitCount));
+}
+
+void LogFindBar::keyPressEvent(QKeyEvent* event)
+{
+    if (event->key() == Qt::Key_Escape)
+    {
+        closeBar();
+        return;
+    }
+    QWidget::keyPressEvent(event);
+}
+
+void LogFindBar::closeBar()
+{
+    setVisible(false);
+    emit closed();
+}
@@ -0,0 +1,45 @@
+#ifndef LOG_FIND_BAR_H
+#define LOG_FIND_BAR_H
+
+#include <QWidget>
+
+QT_BEGIN_NAMESPACE
+class QCheckBox;
+class QLabel;
+class QLineEdit;
+class QTimer;
+QT_END_NAMESPACE
+
+class LogFindBar : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit LogFindBar(QWidget *parent = 0);
+
+    QString text() const;
+    bool useRegex() const;
+
+    void activate();
+    void showStatus(int hitCount, bool running);
+
+signals:
+    void searchChanged();
+    void findNext();
+    void findPrevious();
+    void closed();
+
+protected:
+    void keyPressEvent(QKeyEvent* event) override;
+
+private:
+    QLineEdit* _text;
+    QCheckBox* _useRegex;
+    QLabel* _status;
+    QTimer* _searchTimer;
+
+private slots:
+    void closeBar();
+};
+
+#endif // LOG_FIND_BAR_H
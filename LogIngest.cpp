@@ -0,0 +1,326 @@
+#include "LogIngest.h"
+#include "TextDecoder.h"
+
+#include <QApplication>
+#include <QStringList>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimerEvent>
+#include <QUdpSocket>
+
+#define INGEST_TICK_MS 500
+#define DATAGRAM_PEER_IDLE_TICKS 120
+#define MAX_FRAME_LENGTH (64 * 1024)
+#define MAX_FRAME_LENGTH_DIGITS 5
+#define MAX_LINE_LENGTH (1024 * 1024)
+
+struct LogIngestServer::Peer
+{
+    enum Framing { Unknown, Lines, OctetCounting };
+
+    QScopedPointer<LogFileReader> reader;
+    QScopedPointer<TextDecoder> decoder;
+    Framing framing = Unknown;
+    QByteArray frame; ///< bytes of an incomplete octet-counted frame
+    QString tail;     ///< text of an incomplete line
+    bool active = false;
+    int idleTicks = 0;
+};
+
+namespace {
+
+/**
+    Removes the syslog priority like '<34>' from the start of a message.
+*/
+QString stripPriority(const QString& line)
+{
+    if (!line.startsWith('<')) return line;
+    int close = line.indexOf('>');
+    if (close < 2 || close > 4) return line;
+    for (int i = 1; i < close; i++)
+        if (!line.at(i).isDigit()) return line;
+    return line.mid(close + 1);
+}
+
+/**
+    Parses the header 'LENGTH SP' of an octet-counted frame at the position, the message of the frame
+    must start with a syslog priority. Returns the offset of the message, 0 when more bytes are needed
+    to tell, or -1 when there is no frame, e.g. for a line starting with an epoch time.
+*/
+int frameStart(const QByteArray& data, int pos, int& length)
+{
+    auto isDigit = [&data](int i){ return data.at(i) >= '0' && data.at(i) <= '9'; };
+    length = 0;
+    int i = pos;
+    for (; i < data.size() && i - pos < MAX_FRAME_LENGTH_DIGITS && isDigit(i); i++)
+        length = length * 10 + (data.at(i) - '0');
+    if (i == data.size()) return 0;
+    if (i == pos || data.at(pos) == '0' || data.at(i) != ' ' || length > MAX_FRAME_LENGTH) return -1;
+    if (i + 1 == data.size()) return 0;
+    return data.at(i + 1) == '<' ? i + 1 : -1;
+}
+
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+
+LogIngestServer::LogIngestServer(const LogParams& params, QObject *parent) : QObject(parent), _params(params)
+{
+    _staged.reset(new LogItems);
+    _staged->fields()->setRules(_params.fields);
+}
+
+LogIngestServer::~LogIngestServer()
+{
+    // Pending records are completed to be deleted with the staged ones
+    for (Peer* peer : _connections) peer->reader->endRecord();
+    for (Peer* peer : _datagramPeers) peer->reader->endRecord();
+    qDeleteAll(_connections);
+    qDeleteAll(_datagramPeers);
+}
+
+QString LogIngestServer::start()
+{
+    // Markers are validated once, readers of peers are created without checks then
+    LogItems probe;
+    LogFileReader reader(&_params.marker, &probe, QString(), _params.encoding);
+    QString error = reader.beginLines();
+    if (!error.isEmpty()) return error;
+
+    quint16 port = _params.ingest.port;
+    if (_params.ingest.tcp)
+    {
+        _tcp = new QTcpServer(this);
+        if (!_tcp->listen(QHostAddress::LocalHost, port))
+            return qApp->tr("Unable to listen on TCP port %1: %2").arg(port).arg(_tcp->errorString());
+        connect(_tcp, SIGNAL(newConnection()), this, SLOT(acceptConnection()));
+    }
+    if (_params.ingest.udp)
+    {
+        _udp = new QUdpSocket(this);
+        if (!_udp->bind(QHostAddress::LocalHost, port))
+            return qApp->tr("Unable to bind UDP port %1: %2").arg(port).arg(_udp->errorString());
+        connect(_udp, SIGNAL(readyRead()), this, SLOT(readDatagrams()));
+    }
+    _timerId = startTimer(INGEST_TICK_MS);
+    return QString();
+}
+
+QString LogIngestServer::address() const
+{
+    QStringList protocols;
+    if (_tcp) protocols << "tcp";
+    if (_udp) protocols << "udp";
+    return QString("%1://localhost:%2").arg(protocols.join('+')).arg(_params.ingest.port);
+}
+
+int LogIngestServer::takeStaged(LogItems& target)
+{
+    const QList<LogItem*>& items = _staged->items();
+    for (int i = 0; i < items.size(); i++)
+    {
+        LogItem* item = items.at(i);
+        item->index = target.count();
+        target.append(item);
+        target.fields()->copyRow(*_staged->fields(), i, item->index);
+    }
+    int count = items.size();
+    _staged->takeItems();
+
+    // Readers keep the store, only its string pool is started over, it holds values of taken records only
+    _staged->fields()->resetStrings();
+    return count;
+}
+
+LogIngestServer::Peer* LogIngestServer::makePeer(const QString& name)
+{
+    auto peer = new Peer;
+    peer->reader.reset(new LogFileReader(&_params.marker, _staged.data(), name, _params.encoding));
+    peer->reader->setFieldRules(_params.fields);
+    peer->reader->beginLines();
+    peer->decoder.reset(TextDecoder::create(_params.encoding, QByteArray()));
+    return peer;
+}
+
+void LogIngestServer::acceptConnection()
+{
+    while (QTcpSocket* socket = _tcp->nextPendingConnection())
+    {
+        QString name = QString("tcp://%1:%2").arg(socket->peerAddress().toString()).arg(socket->peerPort());
+        _connections.insert(socket, makePeer(name));
+        connect(socket, SIGNAL(readyRead()), this, SLOT(readConnection()));
+        connect(socket, SIGNAL(disconnected()), this, SLOT(dropConnection()));
+    }
+}
+
+void LogIngestServer::readConnection()
+{
+    auto socket = qobject_cast<QTcpSocket*>(sender());
+    Peer* peer = _connections.value(socket);
+    if (!peer) return;
+
+    QByteArray data = socket->readAll();
+    _receivedBytes += data.size();
+    peer->active = true;
+    readStream(peer, data);
+}
+
+void LogIngestServer::dropConnection()
+{
+    auto socket = qobject_cast<QTcpSocket*>(sender());
+    Peer* peer = _connections.take(socket);
+    if (peer)
+    {
+        // A few bytes could not tell the framing, they are the last line then
+        if (peer->framing == Peer::Unknown && !peer->frame.isEmpty())
+        {
+            peer->framing = Peer::Lines;
+            QByteArray rest = peer->frame;
+            peer->frame.clear();
+            readStream(peer, rest);
+        }
+        if (!peer->tail.isEmpty())
+            addLines(peer, QString(), true);
+        peer->reader->endRecord();
+        delete peer;
+    }
+    socket->deleteLater();
+}
+
+void LogIngestServer::readDatagrams()
+{
+    while (_udp->hasPendingDatagrams())
+    {
+        QByteArray data(int(_udp->pendingDatagramSize()), Qt::Uninitialized);
+        QHostAddress sender;
+        quint16 port;
+        _udp->readDatagram(data.data(), data.size(), &sender, &port);
+        _receivedBytes += data.size();
+
+        QString name = QString("udp://%1:%2").arg(sender.toString()).arg(port);
+        Peer*& peer = _datagramPeers[name];
+        if (!peer) peer = makePeer(name);
+        peer->active = true;
+        readMessage(peer, data);
+    }
+}
+
+void LogIngestServer::readStream(Peer* peer, const QByteArray& data)
+{
+    if (peer->framing == Peer::Lines)
+    {
+        QString text;
+        peer->decoder->decode(data.constData(), data.size(), text);
+        addLines(peer, text, false);
+        return;
+    }
+
+    // Frames are 'LENGTH SP MESSAGE' where the length counts bytes of the message.
+    // Until the first frame header is complete the framing is unknown, only a few bytes are kept then.
+    peer->frame.append(data);
+    int pos = 0;
+    while (pos < peer->frame.size())
+    {
+        int len;
+        int start = frameStart(peer->frame, pos, len);
+        if (start < 0)
+        {
+            // Not a syslog frame, the rest of the stream is taken as lines
+            peer->framing = Peer::Lines;
+            QByteArray rest = peer->frame.mid(pos);
+            peer->frame.clear();
+            readStream(peer, rest);
+            return;
+        }
+        if (start == 0) break;
+        peer->framing = Peer::OctetCounting;
+        if (start + len > peer->frame.size()) break;
+        readMessage(peer, peer->frame.mid(start, len));
+        pos = start + len;
+    }
+    peer->frame.remove(0, pos);
+}
+
+void LogIngestServer::readMessage(Peer* peer, const QByteArray& data)
+{
+    QString text;
+    peer->decoder->decode(data.constData(), data.size(), text);
+    peer->decoder->finish(text);
+    addLines(peer, text, true);
+}
+
+/**
+    Passes complete lines of the text to the reader of the peer. A whole message
+    ends with its last line, otherwise the incomplete last line waits for more text.
+*/
+void LogIngestServer::addLines(Peer* peer, const QString& text, bool whole)
+{
+    QString s = peer->tail.isEmpty() ? text : peer->tail + text;
+    peer->tail.clear();
+
+    int start = 0;
+    bool first = true;
+    while (start < s.size())
+    {
+        int end = s.indexOf('\n', start);
+        if (end < 0)
+        {
+            // A peer never sending a line feed can not make the tail grow without limit
+            if (!whole && s.size() - start <= MAX_LINE_LENGTH)
+            {
+                peer->tail = s.mid(start);
+                return;
+            }
+            end = s.size();
+        }
+        int len = end - start;
+        if (len > 0 && s.at(end - 1) == '\r') len--;
+        QString line = s.mid(start, len);
+        // Every line of a stream is a message, the priority only starts the first line of a datagram or frame
+        if (first || !whole)
+            line = stripPriority(line);
+        first = false;
+        if (!line.isEmpty())
+            peer->reader->addLine(line);
+        start = end + 1;
+    }
+}
+
+void LogIngestServer::timerEvent(QTimerEvent* event)
+{
+    if (event->timerId() != _timerId) return;
+
+    // Records of silent peers are completed, they could wait for the next record forever otherwise
+    auto flush = [this](Peer* peer)
+    {
+        if (peer->active)
+        {
+            peer->active = false;
+            peer->idleTicks = 0;
+            return;
+        }
+        peer->idleTicks++;
+        if (!peer->tail.isEmpty())
+            addLines(peer, QString(), true);
+        peer->reader->endRecord();
+    };
+    for (Peer* peer : _connections)
+        flush(peer);
+    for (auto it = _datagramPeers.begin(); it != _datagramPeers.end(); )
+    {
+        flush(it.value());
+        if (it.value()->idleTicks > DATAGRAM_PEER_IDLE_TICKS)
+        {
+            delete it.value();
+            it = _datagramPeers.erase(it);
+        }
+        else it++;
+    }
+
+    // Records nobody takes must not grow beyond the budget either
+    if (_staged->count() > _params.ingest.maxRecords)
+        _staged->removeFirst(_staged->count() - _params.ingest.maxRecords);
+
+    if (_staged->count() > 0)
+        emit recordsReceived();
+}
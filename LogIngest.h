@@ -0,0 +1,75 @@
+#ifndef LOG_INGEST_H
+#define LOG_INGEST_H
+
+#include <QHash>
+#include <QObject>
+#include <QScopedPointer>
+
+#include "LogProcessor.h"
+
+QT_BEGIN_NAMESPACE
+class QTcpServer;
+class QTcpSocket;
+class QUdpSocket;
+QT_END_NAMESPACE
+
+/**
+    Receives log lines on a local TCP and UDP port and parses them with the marker
+    and field rules of files. TCP streams are either newline-delimited or framed by octet
+    counting as in RFC 6587. A stream is taken as framed when it starts with a length of
+    at most 64 KB followed by a message with a syslog priority. Every UDP datagram
+    is a message. The syslog priority prefix '<N>' of messages is removed.
+
+    Each peer has its own reader, so lines of multi-line records from different
+    peers are not mixed. Records are staged until the owner takes them.
+*/
+class LogIngestServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    LogIngestServer(const LogParams& params, QObject *parent = 0);
+    ~LogIngestServer();
+
+    /// Starts listening. Returns an error message or an empty string on success.
+    QString start();
+
+    QString address() const;
+    int stagedCount() const { return _staged->count(); }
+    qint64 receivedBytes() const { return _receivedBytes; }
+
+    /// Moves records parsed since the last call to the end of the store with values of their fields.
+    /// Returns the number of moved records.
+    int takeStaged(LogItems& target);
+
+signals:
+    void recordsReceived();
+
+private:
+    struct Peer;
+
+    LogParams _params;
+    QTcpServer* _tcp = nullptr;
+    QUdpSocket* _udp = nullptr;
+    QHash<QObject*, Peer*> _connections;
+    QHash<QString, Peer*> _datagramPeers;
+    QScopedPointer<LogItems> _staged;
+    qint64 _receivedBytes = 0;
+    int _timerId = 0;
+
+    Peer* makePeer(const QString& name);
+    void readStream(Peer* peer, const QByteArray& data);
+    void readMessage(Peer* peer, const QByteArray& data);
+    void addLines(Peer* peer, const QString& text, bool whole);
+
+protected:
+    void timerEvent(QTimerEvent*) override;
+
+private slots:
+    void acceptConnection();
+    void readConnection();
+    void dropConnection();
+    void readDatagrams();
+};
+
+#endif // LOG_INGEST_H
@@ -1,7 +1,12 @@
 #include "LogItem.h"
+#include "LogQuery.h"
+#include "LogTextSource.h"
 
 #include <QDebug>
 
+#include <algorithm>
+#include <atomic>
+
 //--------------------------------------------------------------------------------------------------
 
 QString LogItem::typeStr() const
@@ -16,11 +21,88 @@ QString LogItem::typeStr() const
     return QString();
 }
 
+QString LogItem::content() const
+{
+    return source ? source->text(offset, length) : text;
+}
+
 QString LogItem::str() const
 {
     return QString("%1 [%2]: %3").arg(moment, typeStr(), header);
 }
 
+constexpr qint64 LogItem::NoTime;
+
+namespace {
+
+qint64 daysFromCivil(int y, int m, int d)
+{
+    // Howard Hinnant's days_from_civil algorithm
+    y -= m <= 2;
+    const qint64 era = (y >= 0 ? y : y - 399) / 400;
+    const int yoe = y - era * 400;
+    const int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+} // namespace
+
+qint64 LogItem::parseMoment(const QStringRef& s)
+{
+    // Split the moment into numbers, it is much faster than QDateTime::fromString
+    const int maxFields = 7;
+    int values[maxFields], digits[maxFields];
+    ushort separators[maxFields];
+    int count = 0;
+    const QChar* p = s.unicode();
+    const QChar* end = p + s.size();
+    while (p < end && count < maxFields)
+    {
+        while (p < end && !p->isDigit()) p++;
+        if (p == end) break;
+        separators[count] = count > 0 ? (p-1)->unicode() : 0;
+        int value = 0, n = 0;
+        while (p < end && p->isDigit() && n < 9)
+        {
+            value = value * 10 + p->digitValue();
+            p++; n++;
+        }
+        values[count] = value;
+        digits[count] = n;
+        count++;
+    }
+    if (count < 3) return NoTime;
+
+    int year = 1970, month = 1, day = 1, first = 0;
+    if (separators[1] != ':')
+    {
+        if (count < 6) return NoTime;
+        if (digits[0] == 4)
+        {
+            year = values[0]; month = values[1]; day = values[2];
+        }
+        else if (digits[2] == 4)
+        {
+            day = values[0]; month = values[1]; year = values[2];
+        }
+        else return NoTime;
+        first = 3;
+    }
+    int hour = values[first], minute = values[first+1], second = values[first+2];
+    if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60)
+        return NoTime;
+
+    int msec = 0;
+    if (first + 3 < count && (separators[first+3] == '.' || separators[first+3] == ','))
+    {
+        msec = values[first+3];
+        for (int n = digits[first+3]; n > 3; n--) msec /= 10;
+        for (int n = digits[first+3]; n < 3; n++) msec *= 10;
+    }
+    return ((daysFromCivil(year, month, day) * 24 + hour) * 60 + minute) * 60000LL + second * 1000LL + msec;
+}
+
 //--------------------------------------------------------------------------------------------------
 
 LogItems::~LogItems()
@@ -28,6 +110,38 @@ LogItems::~LogItems()
     for (LogItem* i : _items) delete i;
 }
 
+QList<LogItem*> LogItems::takeItems()
+{
+    QList<LogItem*> items;
+    items.swap(_items);
+    _fields.takeRows();
+    _generation = 0;
+    _removed = 0;
+    return items;
+}
+
+void LogItems::removeFirst(int count)
+{
+    count = qMin(count, _items.size());
+    if (count <= 0) return;
+
+    for (int i = 0; i < count; i++)
+        delete _items.at(i);
+    _items.erase(_items.begin(), _items.begin() + count);
+    for (int i = 0; i < _items.size(); i++)
+        _items.at(i)->index = i;
+    _fields.removeFirstRows(count);
+    _removed += count;
+}
+
+quint64 LogItems::generation() const
+{
+    static std::atomic<quint64> lastGeneration(0);
+    if (!_generation)
+        _generation = ++lastGeneration;
+    return _generation;
+}
+
 QString LogItems::str() const
 {
     QStringList messages;
@@ -38,29 +152,100 @@ QString LogItems::str() const
 
 //--------------------------------------------------------------------------------------------------
 
+bool LogView::contains(int index) const
+{
+    if (!_items || index < 0 || index >= _items->count()) return false;
+    return _all || std::binary_search(_indexes.begin(), _indexes.end(), index);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+LogFilters::LogFilters() : _query(new LogQuery)
+{
+}
+
 LogFilters::~LogFilters()
 {
    for (LogFilterBase* f : _includingFilters) delete f;
    for (LogFilterBase* f : _excludingFilters) delete f;
    for (LogFilterBase* f : _searchingFilters) delete f;
+   delete _query;
 }
 
-bool LogFilters::accept(const LogItem *item) const
+namespace {
+
+QString textFilterExpression(const LogFilterBase* filter)
 {
-    for (LogFilterBase* f : _excludingFilters)
-        if (!f->accept(item)) return false;
+    auto f = dynamic_cast<const LogItemTextFilter*>(filter);
+    if (!f || !f->enabled() || f->text().isEmpty()) return QString();
+    return (f->useRegex() ? "re:" : "text:") + LogQuery::quote(f->text());
+}
+
+} // namespace
 
-    if (_includingFilters.isEmpty())
-        return true;
+QString LogFilters::filtersExpression() const
+{
+    QStringList parts;
 
-    for (LogFilterBase* f : _includingFilters)
-        if (f->accept(item))
+    for (const LogFilterBase* f : _excludingFilters)
+    {
+        QString s = textFilterExpression(f);
+        if (!s.isEmpty()) parts << "NOT " + s;
+    }
+
+    if (!_includingFilters.isEmpty())
+    {
+        QStringList levels;
+        for (const LogFilterBase* f : _includingFilters)
         {
-            if (!_searchingFilters.isEmpty())
-                for (LogFilterBase* f : _searchingFilters)
-                    if (!f->accept(item)) return false;
-            return true;
+            auto typeFilter = dynamic_cast<const LogItemTypeFilter*>(f);
+            if (typeFilter && typeFilter->enabled())
+                levels << LogItem(typeFilter->type()).typeStr().toLower();
         }
+        parts << "level:" + (levels.isEmpty() ? QString("none") : levels.join(','));
+    }
 
-    return false;
+    for (const LogFilterBase* f : _searchingFilters)
+    {
+        QString s = textFilterExpression(f);
+        if (!s.isEmpty()) parts << s;
+    }
+
+    return parts.join(" AND ");
+}
+
+QString LogFilters::expression() const
+{
+    QString filters = filtersExpression();
+    QString custom = _customQuery.trimmed();
+    if (custom.isEmpty()) return filters;
+    if (filters.isEmpty()) return custom;
+    return filters + " AND (" + custom + ')';
+}
+
+void LogFilters::setFields(const LogFields* fields)
+{
+    QHash<QString, LogFieldRule::Type> types;
+    for (int i = 0; i < fields->count(); i++)
+        types.insert(fields->column(i).name, fields->column(i).type);
+    _query->setFieldTypes(types);
+}
+
+QString LogFilters::update()
+{
+    // The custom query is parsed apart, unbalanced parentheses in it can not escape the filters
+    return _query->compile(QStringList() << filtersExpression() << _customQuery);
+}
+
+bool LogFilters::accept(const LogItem *item) const
+{
+    return _query->accept(item);
+}
+
+QVector<int> LogFilters::select(const LogItems* items) const
+{
+    LogQueryStats stats(_query->predicates().size());
+    QVector<int> indexes = _query->select(items, stats);
+    _query->adapt(stats);
+    return indexes;
 }
@@ -4,23 +4,48 @@
 #include <QString>
 #include <QList>
 #include <QRegExp>
+#include <QVector>
+
+#include <limits>
+
+#include "LogFields.h"
+
+class LogQuery;
+class LogTextSource;
 
 class LogItem
 {
 public:
     enum Type { Info, Warning, Error, Debug };
+    enum { TypeCount = Debug + 1 };
+
+    /// Value of the time field when the moment could not be recognized.
+    static constexpr qint64 NoTime = std::numeric_limits<qint64>::min();
 
     int index = 0;
     Type type;
+    qint64 time = NoTime; ///< moment as milliseconds since epoch, time zone is not taken into account
+    int momentId = -1;    ///< id of the moment in the string pool of the processor, if interned
+    int headerId = -1;    ///< id of the header in the string pool of the processor, if interned
     QString moment;
-    QString text;
+    QString text;         ///< empty when the record is read from the source on demand
     QString header;
+    const LogTextSource* source = nullptr; ///< set for records of out-of-core datasets
+    qint64 offset = 0;    ///< byte range of the record in the source file
+    int length = 0;
 
     LogItem() { type = Info; }
     LogItem(Type t) { type = t; }
     int number() const { return index+1; }
     QString str() const;
     QString typeStr() const;
+
+    /// Text of the record, it is read from the source file if the record does not hold it.
+    QString content() const;
+
+    /// Recognizes date-time moments like 'dd.MM.yyyy hh:mm:ss.zzz' or 'yyyy-MM-ddThh:mm:ss,zzz'
+    /// and time-only moments like 'hh:mm:ss'. Returns NoTime for unknown formats.
+    static qint64 parseMoment(const QStringRef& s);
 };
 
 //--------------------------------------------------------------------------------------------------
@@ -28,22 +53,77 @@ public:
 class LogItems
 {
 public:
+    LogItems() {}
     ~LogItems();
-    void append(LogItem* item) { _items.append(item); }
+    void append(LogItem* item) { _items.append(item); _fields.appendRow(); }
     const QList<LogItem*>& items() const { return _items; }
+
+    /// Removes all records from the store without deleting them, the caller owns them then.
+    QList<LogItem*> takeItems();
+
+    /// Deletes the first records, indexes of the others are decreased by the count.
+    void removeFirst(int count);
     int count() const { return _items.size(); }
     QString str() const;
+
+    /// Identifies records of the store, it is unique among all stores and changes when records are taken.
+    /// Appending records and removing the first ones keep it, caches follow them by count() and removedCount().
+    quint64 generation() const;
+
+    /// Number of records removed from the start of the store during the generation.
+    qint64 removedCount() const { return _removed; }
+
+    /// Values of user-defined fields, rows follow record indexes.
+    LogFields* fields() { return &_fields; }
+    const LogFields* fields() const { return &_fields; }
 private:
     QList<LogItem*> _items;
+    LogFields _fields;
+    mutable quint64 _generation = 0;
+    qint64 _removed = 0;
+
+    Q_DISABLE_COPY(LogItems)
+};
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+    Non-owning view over records of a LogItems store: either all of them
+    or a subset given by record indexes. The index list is implicitly shared,
+    so views are cheap to copy and pass around.
+*/
+class LogView
+{
+public:
+    LogView() {}
+    explicit LogView(const LogItems* items) : _items(items), _all(true) {}
+    LogView(const LogItems* items, const QVector<int>& indexes) : _items(items), _indexes(indexes) {}
+
+    const LogItems* base() const { return _items; }
+    bool isAll() const { return _all; }
+    int count() const { return !_items ? 0 : (_all ? _items->count() : _indexes.size()); }
+    int indexAt(int i) const { return _all ? i : _indexes.at(i); }
+    const LogItem* at(int i) const { return _items->items().at(indexAt(i)); }
+
+    /// Checks if the record belongs to the view, the indexes must be sorted.
+    bool contains(int index) const;
+
+private:
+    const LogItems* _items = nullptr;
+    QVector<int> _indexes;
+    bool _all = false;
 };
 
 //--------------------------------------------------------------------------------------------------
 
+/**
+    Settings of a filter of the filter panel. Filters do not match records themselves,
+    LogFilters translates them into a query which is evaluated for records.
+*/
 class LogFilterBase
 {
 public:
     virtual ~LogFilterBase() {}
-    virtual bool accept(const LogItem*) const = 0;
     void enable(bool on) { _enabled = on; }
     bool enabled() const { return _enabled; }
 private:
@@ -57,10 +137,7 @@ class LogItemTypeFilter : public LogFilterBase
 public:
     LogItemTypeFilter(LogItem::Type type): _type(type) {}
 
-    bool accept(const LogItem *item) const override
-    {
-        return enabled() && item->type == _type;
-    }
+    LogItem::Type type() const { return _type; }
 private:
     LogItem::Type _type;
 };
@@ -71,48 +148,24 @@ class LogItemTextFilter : public LogFilterBase
 {
 public:
     const QString& text() const { return _text; }
-    void setText(const QString& text) { _text = text; updateRegexp(); }
-    void setUseRegex(bool use) {  _useRegex = use; updateRegexp(); }
+    void setText(const QString& text) { _text = text; }
+    void setUseRegex(bool use) { _useRegex = use; }
     bool useRegex() const { return _useRegex; }
 protected:
     QString _text;
-    QRegExp _regex;
     bool _useRegex = false;
-    void updateRegexp() { if (_useRegex) _regex = QRegExp(_text); }
 };
 
 //--------------------------------------------------------------------------------------------------
 
 class LogItemTextIncludingFilter : public LogItemTextFilter
 {
-public:
-    bool accept(const LogItem *item) const override
-    {
-        if (!enabled() || _text.isEmpty()) return true;
-
-        bool contains = _useRegex
-                ? item->text.contains(_regex)
-                : item->text.contains(_text, Qt::CaseInsensitive);
-
-        return contains;
-    }
 };
 
 //--------------------------------------------------------------------------------------------------
 
 class LogItemTextExcludingFilter : public LogItemTextFilter
 {
-public:
-    bool accept(const LogItem *item) const override
-    {
-        if (!enabled() || _text.isEmpty()) return true;
-
-        bool contains = _useRegex
-                ? item->text.contains(_regex)
-                : item->text.contains(_text, Qt::CaseInsensitive);
-
-        return !contains;
-    }
 };
 
 //--------------------------------------------------------------------------------------------------
@@ -120,21 +173,52 @@ public:
 typedef QList<LogFilterBase*> FilterList;
 typedef QList<LogFilterBase*>* PFilterList;
 
+/**
+    Filters are translated into a query in the filter language (see LogQuery)
+    which is compiled and evaluated for records. The query is only updated by update().
+*/
 class LogFilters
 {
 public:
+    LogFilters();
     ~LogFilters();
 
     PFilterList including() { return &_includingFilters; }
     PFilterList excluding() { return &_excludingFilters; }
     PFilterList searching() { return &_searchingFilters; }
 
+    /// Makes fields of the store known to the query, they are checked when the query is compiled.
+    void setFields(const LogFields* fields);
+
+    /// Query typed by user, it is combined with filters by AND.
+    const QString& customQuery() const { return _customQuery; }
+    void setCustomQuery(const QString& query) { _customQuery = query; }
+
+    /// Query made of enabled filters and the custom query, as it is shown to user.
+    QString expression() const;
+
+    /// Compiles the current expression. Returns an error message, the previous query is kept then.
+    QString update();
+
+    const LogQuery* query() const { return _query; }
+
     bool accept(const LogItem* item) const;
 
+    /// Indexes of records of the store accepted by the query. Measurements of the pass reorder
+    /// the query plan and results of predicates are remembered for next passes. Neither is
+    /// a part of the filters meaning, so it is done on const filters.
+    QVector<int> select(const LogItems* items) const;
+
 private:
     FilterList _includingFilters;
     FilterList _excludingFilters;
     FilterList _searchingFilters;
+    QString _customQuery;
+    LogQuery* _query;
+
+    QString filtersExpression() const;
+
+    Q_DISABLE_COPY(LogFilters)
 };
 
 //--------------------------------------------------------------------------------------------------
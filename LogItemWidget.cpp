@@ -1,16 +1,16 @@
 #include "LogItemWidget.h"
 #include "LogItem.h"
+#include "LogTextView.h"
 #include "helpers/OriWidgets.h"
 
-#include <QPlainTextEdit>
 #include <QVBoxLayout>
 
 LogItemWidget::LogItemWidget(const LogItem* item) : _item(item)
 {
-    _browser = new QPlainTextEdit;
+    _browser = new LogTextView;
     Ori::Gui::setFontMonospace(_browser);
 
     Ori::Gui::layoutV(this, 3, 3, { _browser });
 
-    _browser->setPlainText(item->text);
+    _browser->setItem(item);
 }
@@ -3,11 +3,8 @@
 
 #include <QWidget>
 
-QT_BEGIN_NAMESPACE
-class QPlainTextEdit;
-QT_END_NAMESPACE
-
 class LogItem;
+class LogTextView;
 
 class LogItemWidget : public QWidget
 {
@@ -19,7 +16,7 @@ public:
     const LogItem* item() const { return _item; }
 
 private:
-    QPlainTextEdit* _browser;
+    LogTextView* _browser;
     const LogItem* _item;
 };
 
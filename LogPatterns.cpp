@@ -0,0 +1,145 @@
+#include "LogPatterns.h"
+
+#include <QHash>
+#include <QtConcurrent>
+
+#include <algorithm>
+
+namespace {
+
+typedef QHash<QString, LogPattern> PatternHash;
+
+const QString Placeholder("<*>");
+
+inline bool isTokenChar(QChar c)
+{
+    if (c.isLetterOrNumber()) return true;
+    switch (c.unicode())
+    {
+    case '_': case '-': case '.': case '#': case '@': case '/': case '\\':
+        return true;
+    }
+    return false;
+}
+
+struct ChunkAggregator
+{
+    typedef PatternHash result_type;
+
+    LogView view;
+    int chunkSize;
+
+    PatternHash operator()(int start) const
+    {
+        // Records with interned headers are grouped by header id first,
+        // so each distinct header is tokenized only once per chunk
+        QHash<int, LogPattern> byHeader;
+        PatternHash patterns;
+        int end = qMin(start + chunkSize, view.count());
+        for (int i = start; i < end; i++)
+        {
+            const LogItem* item = view.at(i);
+            LogPattern& p = item->headerId >= 0
+                ? byHeader[item->headerId]
+                : patterns[LogPatterns::makeTemplate(item->header)];
+            if (p.count == 0)
+            {
+                p.firstIndex = item->index;
+                p.text = item->header;
+            }
+            p.lastIndex = item->index;
+            p.count++;
+            p.countByType[item->type]++;
+        }
+        for (auto it = byHeader.constBegin(); it != byHeader.constEnd(); it++)
+            patterns[LogPatterns::makeTemplate(it.value().text)].merge(it.value());
+        return patterns;
+    }
+};
+
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+
+void LogPattern::merge(const LogPattern& other)
+{
+    if (count == 0 || (other.firstIndex >= 0 && other.firstIndex < firstIndex))
+        firstIndex = other.firstIndex;
+    lastIndex = qMax(lastIndex, other.lastIndex);
+    count += other.count;
+    for (int t = 0; t < LogItem::TypeCount; t++)
+        countByType[t] += other.countByType[t];
+}
+
+//--------------------------------------------------------------------------------------------------
+
+QString LogPatterns::makeTemplate(const QString& header)
+{
+    QString res;
+    res.reserve(header.size());
+    const QChar* p = header.unicode();
+    const QChar* end = p + header.size();
+    while (p < end)
+    {
+        QChar c = *p;
+        if (c == '"' || c == '\'')
+        {
+            // Quoted values are variable as a whole
+            const QChar* close = p + 1;
+            while (close < end && *close != c) close++;
+            if (close < end)
+            {
+                res.append(c).append(Placeholder).append(c);
+                p = close + 1;
+                continue;
+            }
+        }
+        if (!isTokenChar(c))
+        {
+            res.append(c);
+            p++;
+            continue;
+        }
+        const QChar* start = p;
+        bool hasDigits = false;
+        while (p < end && isTokenChar(*p))
+        {
+            if (p->isDigit()) hasDigits = true;
+            p++;
+        }
+        if (hasDigits)
+            res.append(Placeholder);
+        else
+            res.append(start, int(p - start));
+    }
+    return res;
+}
+
+void LogPatterns::build(const LogView& view)
+{
+    _patterns.clear();
+    int count = view.count();
+    if (count == 0) return;
+
+    int chunkSize = qMax(10000, count / (qMax(1, QThread::idealThreadCount()) * 4));
+    QVector<int> chunks;
+    for (int start = 0; start < count; start += chunkSize)
+        chunks.append(start);
+
+    QVector<PatternHash> partial = QtConcurrent::blockingMapped<QVector<PatternHash>>(chunks, ChunkAggregator{view, chunkSize});
+
+    PatternHash merged = partial.first();
+    for (int i = 1; i < partial.size(); i++)
+        for (auto it = partial.at(i).constBegin(); it != partial.at(i).constEnd(); it++)
+            merged[it.key()].merge(it.value());
+
+    _patterns.reserve(merged.size());
+    for (auto it = merged.begin(); it != merged.end(); it++)
+    {
+        it.value().text = it.key();
+        _patterns.append(it.value());
+    }
+    std::sort(_patterns.begin(), _patterns.end(), [](const LogPattern& a, const LogPattern& b) {
+        return a.count > b.count;
+    });
+}
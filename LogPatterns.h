@@ -0,0 +1,36 @@
+#ifndef LOG_PATTERNS_H
+#define LOG_PATTERNS_H
+
+#include "LogItem.h"
+
+/**
+    Record headers grouped by template: a header with variable tokens
+    (numbers, identifiers, quoted values) replaced by a placeholder.
+*/
+struct LogPattern
+{
+    QString text;
+    int count = 0;
+    int firstIndex = -1;
+    int lastIndex = -1;
+    int countByType[LogItem::TypeCount] = {};
+
+    void merge(const LogPattern& other);
+};
+
+class LogPatterns
+{
+public:
+    /// Groups records of the view, chunks of records are aggregated in parallel.
+    void build(const LogView& view);
+
+    const QVector<LogPattern>& patterns() const { return _patterns; }
+
+    /// Replaces variable tokens of the header with a placeholder.
+    static QString makeTemplate(const QString& header);
+
+private:
+    QVector<LogPattern> _patterns;
+};
+
+#endif // LOG_PATTERNS_H
@@ -0,0 +1,114 @@
+#include "LogPatternsWidget.h"
+#include "LogPatterns.h"
+
+#include "helpers/OriLayouts.h"
+#include "helpers/OriWidgets.h"
+
+#include <QAbstractTableModel>
+#include <QHeaderView>
+#include <QLabel>
+#include <QSortFilterProxyModel>
+#include <QTableView>
+
+namespace {
+
+enum {
+    COL_COUNT,
+    COL_TEMPLATE,
+    COL_FIRST,
+    COL_LAST,
+    COL_INFO,
+    COL_WARNING,
+    COL_ERROR,
+    COL_DEBUG,
+
+    COL_TOTAL
+};
+
+class LogPatternsModel : public QAbstractTableModel
+{
+public:
+    LogPatternsModel(const LogPatterns* patterns) : _patterns(patterns) {}
+
+    int columnCount(const QModelIndex&) const override { return COL_TOTAL; }
+    int rowCount(const QModelIndex&) const override { return _patterns->patterns().size(); }
+
+    QVariant headerData(int section, Qt::Orientation orientation, int role) const override
+    {
+        if (orientation != Qt::Horizontal || role != Qt::DisplayRole) return QVariant();
+        switch (section)
+        {
+        case COL_COUNT: return tr("Count");
+        case COL_TEMPLATE: return tr("Template");
+        case COL_FIRST: return tr("First");
+        case COL_LAST: return tr("Last");
+        case COL_INFO: return tr("Info");
+        case COL_WARNING: return tr("Warning");
+        case COL_ERROR: return tr("Error");
+        case COL_DEBUG: return tr("Debug");
+        }
+        return QVariant();
+    }
+
+    QVariant data(const QModelIndex &index, int role) const override
+    {
+        if (!index.isValid()) return QVariant();
+        const LogPattern& p = _patterns->patterns().at(index.row());
+        if (role == Qt::UserRole) return p.firstIndex;
+        if (role != Qt::DisplayRole) return QVariant();
+        switch (index.column())
+        {
+        case COL_COUNT: return p.count;
+        case COL_TEMPLATE: return p.text;
+        case COL_FIRST: return p.firstIndex + 1;
+        case COL_LAST: return p.lastIndex + 1;
+        case COL_INFO: return p.countByType[LogItem::Info];
+        case COL_WARNING: return p.countByType[LogItem::Warning];
+        case COL_ERROR: return p.countByType[LogItem::Error];
+        case COL_DEBUG: return p.countByType[LogItem::Debug];
+        }
+        return QVariant();
+    }
+
+private:
+    const LogPatterns* _patterns;
+};
+
+} // namespace
+
+LogPatternsWidget::LogPatternsWidget(LogPatterns* patterns, QWidget *parent) : QWidget(parent), _patterns(patterns)
+{
+    _proxy = new QSortFilterProxyModel(this);
+    _proxy->setSourceModel(new LogPatternsModel(_patterns));
+    _proxy->sourceModel()->setParent(this);
+
+    _table = new QTableView;
+    _table->setModel(_proxy);
+    _table->setSortingEnabled(true);
+    _table->sortByColumn(COL_COUNT, Qt::DescendingOrder);
+    _table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    _table->setSelectionMode(QAbstractItemView::SingleSelection);
+    _table->verticalHeader()->setVisible(false);
+    _table->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    _table->horizontalHeader()->setSectionResizeMode(QHeaderView::Interactive);
+    _table->horizontalHeader()->setSectionResizeMode(COL_TEMPLATE, QHeaderView::Stretch);
+    Ori::Gui::setFontMonospace(_table);
+    connect(_table, SIGNAL(activated(QModelIndex)), this, SLOT(activated(QModelIndex)));
+
+    auto info = new QLabel(tr("Templates: %1. Double click a template to go to its first record.")
+                           .arg(_patterns->patterns().size()));
+
+    Ori::Layouts::LayoutV({info, _table}).setMargin(3).useFor(this);
+}
+
+LogPatternsWidget::~LogPatternsWidget()
+{
+    delete _patterns;
+}
+
+void LogPatternsWidget::activated(const QModelIndex& index)
+{
+    int recordIndex = _proxy->data(index, Qt::UserRole).toInt();
+    if (recordIndex >= 0)
+        emit recordRequested(recordIndex);
+}
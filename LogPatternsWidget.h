@@ -0,0 +1,36 @@
+#ifndef LOG_PATTERNS_WIDGET_H
+#define LOG_PATTERNS_WIDGET_H
+
+#include <QWidget>
+
+QT_BEGIN_NAMESPACE
+class QLabel;
+class QModelIndex;
+class QSortFilterProxyModel;
+class QTableView;
+QT_END_NAMESPACE
+
+class LogPatterns;
+
+class LogPatternsWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    /// Takes ownership of the patterns.
+    explicit LogPatternsWidget(LogPatterns* patterns, QWidget *parent = 0);
+    ~LogPatternsWidget();
+
+signals:
+    void recordRequested(int index);
+
+private:
+    LogPatterns* _patterns;
+    QTableView* _table;
+    QSortFilterProxyModel* _proxy;
+
+private slots:
+    void activated(const QModelIndex& index);
+};
+
+#endif // LOG_PATTERNS_WIDGET_H
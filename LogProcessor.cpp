@@ -1,4 +1,8 @@
 #include "LogProcessor.h"
+#include "FileScanner.h"
+#include "LogIngest.h"
+#include "SpscQueue.h"
+#include "TextDecoder.h"
 #include "helpers/OriDialogs.h"
 #include "tools/OriSettings.h"
 #include "tools/OriWaitCursor.h"
@@ -6,13 +10,30 @@
 #include <QApplication>
 #include <QDebug>
 #include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QScopedPointer>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+#include <cstring>
+#include <limits>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#endif
 
 //--------------------------------------------------------------------------------------------------
 
 LogMarker::LogMarker(const LogMarkerParams& params)
 {
     if (params.regexp)
+    {
         regexp = QRegExp(params.marker, Qt::CaseInsensitive);
+        prefilter = RegexPrefilter(regexp);
+    }
     else
     {
         marker = params.marker;
@@ -45,7 +66,9 @@ bool LogMarker::process(const QString& s, int offset)
     }
     else
     {
-        pos = regexp.indexIn(s, offset);
+        pos = prefilter.startOf(s, offset);
+        if (pos < 0) return false;
+        pos = regexp.indexIn(s, pos);
         if (pos > -1)
         {
             len = regexp.matchedLength();
@@ -57,6 +80,79 @@ bool LogMarker::process(const QString& s, int offset)
 
 //--------------------------------------------------------------------------------------------------
 
+/**
+    Lines of a block of raw bytes, decoded by the offsets of their line feeds.
+    Batches are reused, so strings of lines keep their capacity between blocks.
+*/
+struct FileReader::LineBatch
+{
+    QVector<QString> lines;
+    QVector<qint64> starts; ///< byte offsets of lines in the file
+    QVector<int> lengths;   ///< byte lengths of lines without line breaks
+    int count = 0;
+    bool last = false;
+};
+
+/**
+    Finds line feeds of a block in one pass producing their offsets, then decodes
+    complete lines of the block by the offsets. The incomplete last line is carried over
+    to the next block, so the byte range of every line in the file is known.
+*/
+struct FileReader::LineSplitter
+{
+    LineScanner scanner;
+    TextDecoder* decoder;
+    PerfCounters* perf;
+    QByteArray buf;
+    qint64 bufStart = 0;
+    int scanned = 0;
+    QVector<int> feeds;
+
+    LineSplitter(const LineScanner& scanner, TextDecoder* decoder, PerfCounters* perf)
+        : scanner(scanner), decoder(decoder), perf(perf) {}
+
+    void split(const char* block, int size, bool last, LineBatch& batch);
+};
+
+/**
+    Buffers and queues between stages of the pipelined reader. Raw blocks go from the
+    read stage to the decode stage and back to the pool, batches of decoded lines go from
+    the decode stage to the parsing thread and back. Every queue has room for all items
+    it can ever hold, so returning an item to its pool never waits.
+*/
+struct FileReader::Pipeline
+{
+    enum { BlockSize = 4 * 1024 * 1024, BlockCount = 4, BatchCount = 3 };
+
+    struct Block
+    {
+        QByteArray data;
+        int size = 0;
+        bool last = false;
+    };
+
+    Block blocks[BlockCount];
+    LineBatch batches[BatchCount];
+    SpscQueue<Block*, BlockCount> freeBlocks, fullBlocks;
+    SpscQueue<LineBatch*, BatchCount> freeBatches, fullBatches;
+    std::atomic<bool> cancelled{false};
+    qint64 bytesLeft;
+
+    explicit Pipeline(qint64 maxBytes)
+    {
+        bytesLeft = maxBytes > 0 ? maxBytes : std::numeric_limits<qint64>::max();
+        for (Block& block : blocks)
+        {
+            block.data.resize(BlockSize);
+            freeBlocks.tryPush(&block);
+        }
+        for (LineBatch& batch : batches)
+            freeBatches.tryPush(&batch);
+    }
+};
+
+//--------------------------------------------------------------------------------------------------
+
 FileReader::FileReader(const QString& file, const QString& encoding): _file(file), _encoding(encoding)
 {
 }
@@ -68,27 +164,282 @@ FileReader::~FileReader()
 QString FileReader::read()
 {
     QFile input(_file);
-    if (!input.open(QIODevice::Text | QIODevice::ReadOnly))
+    if (!input.open(QIODevice::ReadOnly))
         return input.errorString();
 
     QString res = processStart();
     if (!res.isEmpty()) return res;
 
-    QTextStream stream(&input);
-    stream.setCodec(_encoding.toStdString().data());
-    stream.setAutoDetectUnicode(true);
+    // Reading raw blocks and decoding them separately (instead of QTextStream)
+    // lets I/O and decoding time be accounted in different phases.
+    // Whole blocks are decoded at once by table-driven decoders.
+    QScopedPointer<TextDecoder> decoder(TextDecoder::create(_encoding, input.peek(4)));
+
+    if (_trackOffsets && !decoder->asciiCompatible())
+        _trackOffsets = false;
+
+    // Lines are split before decoding unless line feeds can not be found in raw bytes, e.g. in UTF-32.
+    // Files of a few blocks are read in the calling thread, the pipeline would only cost thread startup there.
+    LineScanner scanner(decoder->lineUnits());
+    qint64 readSize = _maxBytes > 0 ? qMin(_maxBytes, input.size()) : input.size();
+    if (scanner.units() == LineScanner::Unsupported)
+        readBlocks(input, decoder.data());
+    else if (readSize > 2 * Pipeline::BlockSize && QThread::idealThreadCount() > 1)
+        readPipelined(input, decoder.data(), scanner);
+    else
+        readLines(input, decoder.data(), scanner);
+    processDone();
 
-    QString line("");
-    while (!line.isNull())
+    return _errors.isEmpty()? QString(): _errors.join("\n");
+}
+
+void FileReader::readBlocks(QFile& input, TextDecoder* decoder)
+{
+    const qint64 blockSize = 1024 * 1024;
+    qint64 bytesLeft = _maxBytes > 0 ? _maxBytes : std::numeric_limits<qint64>::max();
+    QByteArray block;
+    QString text;
+    int pos = 0;
+    bool last = false;
+    while (!last)
     {
-        line = stream.readLine();
-        if (!line.isEmpty())
-            if (!processLine(line))
-                break;
+        {
+            PerfTimer timer(_perf, PerfCounters::Read);
+            block = bytesLeft > 0 ? input.read(qMin(blockSize, bytesLeft)) : QByteArray();
+        }
+        bytesLeft -= block.size();
+        last = block.isEmpty();
+        if (_perf) _perf->addBytes(PerfCounters::Read, block.size());
+
+        {
+            PerfTimer timer(_perf, PerfCounters::Decode);
+            text.remove(0, pos);
+            pos = 0;
+            if (last)
+                decoder->finish(text);
+            else
+                decoder->decode(block.constData(), block.size(), text);
+        }
+        if (_perf) _perf->addBytes(PerfCounters::Decode, block.size());
+
+        if (!processBlock(text, pos, last))
+            break;
     }
-    processDone();
+}
 
-    return _errors.isEmpty()? QString(): _errors.join("\n");
+void FileReader::LineSplitter::split(const char* block, int size, bool last, LineBatch& batch)
+{
+    if (bufStart == 0 && buf.isEmpty() && size >= 3 && std::memcmp(block, "\xEF\xBB\xBF", 3) == 0)
+    {
+        block += 3;
+        size -= 3;
+        bufStart = 3;
+    }
+    buf.append(block, size);
+    const char* data = buf.constData();
+    const int unit = scanner.unitSize();
+
+    feeds.resize(0);
+    {
+        PerfTimer timer(perf, PerfCounters::Split);
+        scanned = scanner.scan(data, buf.size(), scanned, feeds);
+    }
+    if (perf) perf->addBytes(PerfCounters::Split, size);
+
+    // The rest of the input is the last line even without a line feed
+    int tail = feeds.isEmpty() ? 0 : feeds.last() + unit;
+    if (last && tail < buf.size())
+        feeds.append(buf.size());
+
+    batch.count = feeds.size();
+    batch.last = last;
+    if (batch.lines.size() < batch.count)
+    {
+        batch.lines.resize(batch.count);
+        batch.starts.resize(batch.count);
+        batch.lengths.resize(batch.count);
+    }
+    int start = 0;
+    {
+        PerfTimer timer(perf, PerfCounters::Decode);
+        for (int i = 0; i < batch.count; i++)
+        {
+            int len = scanner.lineLength(data, start, feeds.at(i));
+            QString& line = batch.lines[i];
+            line.resize(0);
+            if (len > 0)
+            {
+                decoder->decode(data + start, len, line);
+                decoder->finish(line);
+            }
+            batch.starts[i] = bufStart + start;
+            batch.lengths[i] = len;
+            start = feeds.at(i) + unit;
+        }
+    }
+    int consumed = qMin(start, buf.size());
+    if (perf) perf->addBytes(PerfCounters::Decode, consumed);
+    buf.remove(0, consumed);
+    bufStart += consumed;
+    scanned -= consumed;
+}
+
+/**
+    Reads, splits and processes blocks one after another in the calling thread.
+*/
+void FileReader::readLines(QFile& input, TextDecoder* decoder, const LineScanner& scanner)
+{
+    const qint64 blockSize = 1024 * 1024;
+    qint64 bytesLeft = _maxBytes > 0 ? _maxBytes : std::numeric_limits<qint64>::max();
+    LineSplitter splitter(scanner, decoder, _perf);
+    LineBatch batch;
+    QByteArray block;
+    bool last = false;
+    while (!last)
+    {
+        {
+            PerfTimer timer(_perf, PerfCounters::Read);
+            block = bytesLeft > 0 ? input.read(qMin(blockSize, bytesLeft)) : QByteArray();
+        }
+        if (_perf) _perf->addBytes(PerfCounters::Read, block.size());
+        bytesLeft -= block.size();
+        last = block.isEmpty();
+
+        splitter.split(block.constData(), block.size(), last, batch);
+        if (!processBatch(batch))
+            return;
+    }
+}
+
+bool FileReader::processBatch(const LineBatch& batch)
+{
+    for (int i = 0; i < batch.count; i++)
+    {
+        int len = batch.lengths.at(i);
+        _lineStart = batch.starts.at(i);
+        _lineEnd = _lineStart + len;
+        if (len > 0 && !processLine(batch.lines.at(i)))
+            return false;
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+namespace {
+
+/// Asks the system to read the range of the file ahead, the read stage will need it soon.
+void adviseReadahead(QFile* file, qint64 offset, qint64 size, bool sequential)
+{
+#ifdef Q_OS_LINUX
+    if (sequential)
+        posix_fadvise(file->handle(), 0, 0, POSIX_FADV_SEQUENTIAL);
+    posix_fadvise(file->handle(), offset, size, POSIX_FADV_WILLNEED);
+#else
+    Q_UNUSED(file)
+    Q_UNUSED(offset)
+    Q_UNUSED(size)
+    Q_UNUSED(sequential)
+#endif
+}
+
+} // namespace
+
+/**
+    Reads the file in three stages running at the same time: I/O, decoding and parsing,
+    the last one in the calling thread. Each stage works on its own block while the others
+    work on the neighbours, so throughput is limited by the slowest stage instead of the sum.
+*/
+void FileReader::readPipelined(QFile& input, TextDecoder* decoder, const LineScanner& scanner)
+{
+    Pipeline pipeline(_maxBytes);
+    adviseReadahead(&input, input.pos(), Pipeline::BlockSize * Pipeline::BlockCount, true);
+
+    // Stages wait for each other, so they get threads of their own instead of the shared pool
+    QThreadPool pool;
+    pool.setMaxThreadCount(2);
+    QtConcurrent::run(&pool, this, &FileReader::readStage, &input, &pipeline);
+    QtConcurrent::run(&pool, this, &FileReader::decodeStage, &pipeline, decoder, scanner);
+
+    LineBatch* batch;
+    while (pipeline.fullBatches.pop(batch, pipeline.cancelled))
+    {
+        bool last = batch->last;
+        bool more = processBatch(*batch);
+        pipeline.freeBatches.push(batch, pipeline.cancelled);
+        if (!more)
+            pipeline.cancelled = true;
+        if (!more || last)
+            break;
+    }
+    pool.waitForDone();
+}
+
+void FileReader::readStage(QFile* input, Pipeline* pipeline)
+{
+    qint64 offset = input->pos();
+    Pipeline::Block* block;
+    while (pipeline->freeBlocks.pop(block, pipeline->cancelled))
+    {
+        qint64 size = qMin<qint64>(Pipeline::BlockSize, pipeline->bytesLeft);
+        {
+            PerfTimer timer(_perf, PerfCounters::Read);
+            block->size = size > 0 ? int(qMax<qint64>(0, input->read(block->data.data(), size))) : 0;
+        }
+        if (_perf) _perf->addBytes(PerfCounters::Read, block->size);
+        pipeline->bytesLeft -= block->size;
+        offset += block->size;
+        block->last = block->size == 0;
+        if (!block->last)
+            adviseReadahead(input, offset + Pipeline::BlockSize, Pipeline::BlockSize, false);
+
+        if (!pipeline->fullBlocks.push(block, pipeline->cancelled) || block->last)
+            return;
+    }
+}
+
+void FileReader::decodeStage(Pipeline* pipeline, TextDecoder* decoder, LineScanner scanner)
+{
+    LineSplitter splitter(scanner, decoder, _perf);
+    Pipeline::Block* block;
+    LineBatch* batch;
+    while (pipeline->fullBlocks.pop(block, pipeline->cancelled))
+    {
+        if (!pipeline->freeBatches.pop(batch, pipeline->cancelled))
+            return;
+        bool last = block->last;
+        splitter.split(block->data.constData(), block->size, last, *batch);
+        pipeline->freeBlocks.push(block, pipeline->cancelled);
+
+        if (!pipeline->fullBatches.push(batch, pipeline->cancelled) || last)
+            return;
+    }
+}
+
+/**
+    Passes all complete lines of the text starting from pos to processLine().
+    On return pos points to the start of the incomplete tail line
+    that is kept to be continued by the next decoded block.
+*/
+bool FileReader::processBlock(const QString& text, int& pos, bool last)
+{
+    while (pos < text.length())
+    {
+        int end = text.indexOf('\n', pos);
+        if (end < 0)
+        {
+            if (!last) return true;
+            end = text.length();
+        }
+        int len = end - pos;
+        if (len > 0 && text.at(end-1) == '\r') len--;
+        int start = pos;
+        pos = end + 1;
+        if (len > 0)
+            if (!processLine(text.mid(start, len)))
+                return false;
+    }
+    return true;
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -115,16 +466,61 @@ QString LogFileReader::processStart()
 
 bool LogFileReader::processLine(const QString& line)
 {
-    auto item = newItem(line);
+    LogItem* item;
+    {
+        PerfSampledTimer timer(_perf, PerfCounters::Match, _perfTicks[PerfCounters::Match]);
+        item = newItem(line);
+    }
     if (item)
     {
         finishItem();
+        if (_maxRecords > 0 && _log->count() >= _maxRecords)
+        {
+            delete item;
+            return false;
+        }
         _item = item;
+        if (tracksOffsets())
+        {
+            _item->source = _source;
+            _item->offset = lineStart();
+        }
     }
-    _message.append(line);
+    // Received lines coming after a record was completed by idle time would be glued to the next one
+    if (!_item && _dropOrphanLines)
+        return true;
+    if (tracksOffsets())
+        _messageEnd = lineEnd();
+    else
+        _message.append(line);
+    if (_item && !_fieldRules.isEmpty())
+        extractFields(line);
     return true;
 }
 
+void LogFileReader::setFieldRules(const QVector<LogFieldRule>& rules)
+{
+    _fieldRules = rules;
+    _fieldValues.clear();
+    for (int i = 0; i < rules.size(); i++)
+        _fieldValues.append(QString());
+}
+
+/**
+    The first value found in lines of a record is taken for each field.
+*/
+void LogFileReader::extractFields(const QString& line)
+{
+    PerfSampledTimer timer(_perf, PerfCounters::Extract, _perfTicks[PerfCounters::Extract]);
+    for (int i = 0; i < _fieldRules.size(); i++)
+        if (_fieldValues.at(i).isNull())
+        {
+            QString value;
+            if (_fieldRules.at(i).extract(line, value))
+                _fieldValues[i] = value.isNull() ? QString("") : value;
+        }
+}
+
 void LogFileReader::processDone()
 {
     finishItem();
@@ -142,7 +538,13 @@ LogItem* LogFileReader::newItem(const QString& s)
     if (item)
     {
         item->moment = s.leftRef(markerStart-1).trimmed().toString();
+        item->time = LogItem::parseMoment(QStringRef(&item->moment));
         item->header = s.rightRef(s.length()-markerEnd-1).trimmed().toString();
+        if (_pool)
+        {
+            item->momentId = _pool->intern(item->moment);
+            item->headerId = _pool->intern(item->header);
+        }
     }
     return item;
 }
@@ -175,15 +577,33 @@ void LogFileReader::finishItem()
 {
     if (!_item) return;
 
-    _item->text = _message.join('\n');
-    _message.clear();
+    if (tracksOffsets())
+        _item->length = int(_messageEnd - _item->offset);
+    else
+    {
+        PerfSampledTimer timer(_perf, PerfCounters::Join, _perfTicks[PerfCounters::Join]);
+        _item->text = _message.join('\n');
+        _message.clear();
+    }
+    if (_perf) _perf->addRecords(PerfCounters::Join, 1);
 
     _log->append(_item);
     _item->index = _log->items().size()-1;
 
+    for (int i = 0; i < _fieldValues.size(); i++)
+        if (!_fieldValues.at(i).isNull())
+        {
+            _log->fields()->set(i, _item->index, _fieldValues.at(i));
+            _fieldValues[i] = QString();
+        }
+    if (_perf && !_fieldRules.isEmpty()) _perf->addRecords(PerfCounters::Extract, 1);
+    if (_histogram) _histogram->append(_item);
+
     auto type = _item->type;
     int count = _countByType.contains(type)? _countByType[type]: 0;
     _countByType[type] = count+1;
+
+    _item = nullptr;
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -192,35 +612,351 @@ LogProcessor::LogProcessor(QObject* parent) : QObject(parent)
 {
 }
 
+LogProcessor::~LogProcessor()
+{
+    stopIngest();
+    for (const LogFileInfo& info : _files)
+        delete info.source;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+LogFileInfo LogFileInfo::identify(const QString& path)
+{
+    const int headSize = 4096;
+
+    LogFileInfo info;
+    info.path = path;
+    QFileInfo fileInfo(path);
+    info.size = fileInfo.size();
+    info.modified = fileInfo.lastModified();
+    QFile file(path);
+    if (file.open(QIODevice::ReadOnly))
+        info.headHash = qHash(file.read(headSize));
+    return info;
+}
+
+bool LogFileInfo::isSame(const LogFileInfo& other) const
+{
+    return size == other.size && modified == other.modified && headHash == other.headHash;
+}
+
+//--------------------------------------------------------------------------------------------------
+
 bool LogProcessor::open(const LogParams &params)
 {
+    if (params.ingest.enabled) return listen(params);
     if (params.files.empty()) return false;
 
     _params = params;
+    for (QString& file : _params.files)
+        file = QDir::cleanPath(file);
+    _pageCache.setBudget(params.pageCacheSize);
+    _log.fields()->setRules(params.fields);
+    _log.fields()->setKeyColumn(_log.fields()->indexOf(params.correlationKey));
     _path = QFileInfo(params.files.first()).absolutePath();
+    _knownFiles = listDirectory();
 
     Ori::WaitCursor wait;
 
-    _filesCount = 0;
-    for (const QString& file: params.files)
+    _perf.reset();
+    QElapsedTimer timer;
+    timer.start();
+
+    for (const QString& file: _params.files)
+        loadFile(file);
+    finishLoading();
+
+    _perf.setTotalTime(timer.nsecsElapsed());
+    return true;
+}
+
+bool LogProcessor::reload()
+{
+    if (_ingest) return false;
+
+    Ori::WaitCursor wait;
+
+    _perf.reset();
+    QElapsedTimer timer;
+    timer.start();
+
+    // Files appeared in the directory since the last time are added to the dataset,
+    // files that were there but not selected are still ignored
+    QStringList listing = listDirectory();
+    for (const QString& file : listing)
+        if (!_knownFiles.contains(file) && !_params.files.contains(file))
+            _params.files.append(file);
+    _knownFiles = listing;
+
+    QVector<LogFieldColumn> oldFields = _log.fields()->takeRows();
+    QList<LogItem*> oldItems = _log.takeItems();
+    QList<LogFileInfo> oldFiles = _files;
+    _files.clear();
+    _histogram.clear();
+
+    bool changed = false;
+    for (const QString& file : _params.files)
     {
-        QString res = processFile(file);
-        if (!res.isEmpty())
+        int old = -1;
+        for (int i = 0; i < oldFiles.size(); i++)
+            if (oldFiles.at(i).path == file)
+            {
+                old = i;
+                break;
+            }
+
+        if (old >= 0 && oldFiles.at(old).isSame(LogFileInfo::identify(file)))
         {
-            Ori::Dlg::error(tr("Error while processing file\n%1:\n\n%2\n\nFile is skipped").arg(file, res));
+            LogFileInfo info = oldFiles.at(old);
+            int first = _log.count();
+            for (int i = 0; i < info.recordCount; i++)
+            {
+                LogItem* item = oldItems.at(info.firstRecord + i);
+                oldItems[info.firstRecord + i] = nullptr;
+                item->index = _log.count();
+                _log.append(item);
+                _log.fields()->copyRow(oldFields, info.firstRecord + i, item->index);
+                _histogram.append(item);
+            }
+            info.firstRecord = first;
+            _files.append(info);
+            oldFiles[old].source = nullptr;
             continue;
         }
-        _filesCount++;
+
+        changed = true;
+        if (QFileInfo::exists(file))
+            loadFile(file);
+    }
+    if (oldFiles.size() != _files.size())
+        changed = true;
+
+    qDeleteAll(oldItems);
+    for (const LogFileInfo& info : oldFiles)
+        delete info.source;
+    if (_params.outOfCore)
+        _pageCache.clear();
+
+    finishLoading();
+    _perf.setTotalTime(timer.nsecsElapsed());
+    return changed;
+}
+
+namespace {
+
+/// Payloads of strings of the record, interned strings are counted once by the pool.
+qint64 stringBytes(const LogItem* item)
+{
+    qint64 bytes = StringPool::bytes(item->text);
+    if (item->momentId < 0) bytes += StringPool::bytes(item->moment);
+    if (item->headerId < 0) bytes += StringPool::bytes(item->header);
+    return bytes;
+}
+
+/// Approximate memory taken by a received record with its field values,
+/// it is what the byte budget of ingestion limits.
+qint64 recordBytes(const LogItems& log, int index)
+{
+    const LogItem* item = log.items().at(index);
+    return qint64(sizeof(LogItem)) + StringPool::bytes(item->text) +
+           StringPool::bytes(item->moment) + StringPool::bytes(item->header) +
+           log.fields()->rowBytes(index);
+}
+
+} // namespace
+
+bool LogProcessor::listen(const LogParams& params)
+{
+    _params = params;
+    _params.outOfCore = false; // received records are not backed by files
+    _log.fields()->setRules(params.fields);
+    _log.fields()->setKeyColumn(_log.fields()->indexOf(params.correlationKey));
+    _perf.reset();
+
+    QScopedPointer<LogIngestServer> server(new LogIngestServer(_params, this));
+    QString res = server->start();
+    if (!res.isEmpty())
+    {
+        Ori::Dlg::error(tr("Unable to receive records:\n\n%1").arg(res));
+        return false;
     }
+    _ingest = server.take();
+    _ingestBytes = 0;
+    _ingestStrings = 0;
+    _path = _ingest->address();
+    connect(_ingest, SIGNAL(recordsReceived()), this, SIGNAL(recordsReceived()));
+    finishLoading();
     return true;
 }
 
-QString LogProcessor::processFile(const QString& file)
+void LogProcessor::stopIngest()
+{
+    delete _ingest;
+    _ingest = nullptr;
+}
+
+int LogProcessor::commitIngested()
+{
+    if (!_ingest || _ingest->stagedCount() == 0) return -1;
+
+    // Only new and dropped records are visited, the log can be much longer than a commit
+    int first = _log.count();
+    _ingest->takeStaged(_log);
+    for (int i = first; i < _log.count(); i++)
+    {
+        const LogItem* item = _log.items().at(i);
+        _ingestBytes += recordBytes(_log, i);
+        _ingestStrings += stringBytes(item);
+        _histogram.append(item);
+        _countByType[item->type]++;
+    }
+    int dropped = applyRetention();
+    _histogram.removeFirst(dropped);
+
+    _sourceSize = _ingest->receivedBytes();
+    return dropped;
+}
+
+/**
+    Drops the oldest records when the log exceeds any of the budgets. Records are dropped
+    in batches down to 15/16 of the budgets, so the log is not shifted on every commit.
+*/
+int LogProcessor::applyRetention()
+{
+    const LogIngestParams& p = _params.ingest;
+    if (_log.count() <= p.maxRecords && _ingestBytes <= p.maxBytes) return 0;
+
+    int keepRecords = p.maxRecords - p.maxRecords / 16;
+    qint64 keepBytes = p.maxBytes - p.maxBytes / 16;
+    const QList<LogItem*>& items = _log.items();
+    int count = 0;
+    while (count < items.size() && (items.size() - count > keepRecords || _ingestBytes > keepBytes))
+    {
+        const LogItem* item = items.at(count);
+        _ingestBytes -= recordBytes(_log, count);
+        _ingestStrings -= stringBytes(item);
+        _countByType[item->type]--;
+        count++;
+    }
+    if (count > 0)
+        emit recordsAboutToBeDropped();
+    _log.removeFirst(count);
+
+    // Field values of dropped records stay in the string pool until it is rebuilt from the rest
+    _log.fields()->compactStrings();
+    return count;
+}
+
+QStringList LogProcessor::listDirectory() const
+{
+    if (_params.directory.isEmpty()) return QStringList();
+
+    // Names are matched the same way as in the file list of the open dialog
+    auto filters = FileScanner::nameFilters(_params.filter, _params.filterCase);
+    QStringList files;
+    QDirIterator it(_params.directory, QDir::Files,
+                    _params.recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
+    while (it.hasNext())
+    {
+        QString file = it.next();
+        if (FileScanner::matches(filters, it.fileName()))
+            files.append(QDir::cleanPath(file));
+    }
+    files.sort(Qt::CaseInsensitive);
+    return files;
+}
+
+void LogProcessor::loadFile(const QString& file)
+{
+    LogFileInfo info = LogFileInfo::identify(file);
+    info.firstRecord = _log.count();
+
+    QString res = processFile(file, info);
+    if (!res.isEmpty())
+    {
+        delete info.source;
+        Ori::Dlg::error(tr("Error while processing file\n%1:\n\n%2\n\nFile is skipped").arg(file, res));
+        return;
+    }
+    info.recordCount = _log.count() - info.firstRecord;
+    _files.append(info);
+}
+
+QString LogProcessor::processFile(const QString& file, LogFileInfo& info)
 {
     LogFileReader reader(&_params.marker, &_log, file, _params.encoding);
+    reader.setPerfCounters(&_perf);
+    reader.setStringPool(&_strings);
+    reader.setHistogram(&_histogram);
+    reader.setFieldRules(_params.fields);
+    if (_params.outOfCore)
+    {
+        info.source = new LogTextSource(file, _params.encoding, &_pageCache);
+        reader.setTextSource(info.source);
+    }
     QString res = reader.read();
-    _countByType = reader.countByType();
+    info.countByType = reader.countByType();
     return res;
 }
 
+void LogProcessor::finishLoading()
+{
+    _filesCount = _files.size();
+    _sourceSize = 0;
+    _countByType.clear();
+    for (const LogFileInfo& info : _files)
+    {
+        _sourceSize += info.size;
+        for (auto it = info.countByType.constBegin(); it != info.countByType.constEnd(); it++)
+            _countByType[it.key()] += it.value();
+    }
+}
 
+bool LogProcessor::locateRecord(int index, QString& file, int& ordinal) const
+{
+    for (const LogFileInfo& info : _files)
+        if (index >= info.firstRecord && index < info.firstRecord + info.recordCount)
+        {
+            file = info.path;
+            ordinal = index - info.firstRecord;
+            return true;
+        }
+    return false;
+}
+
+int LogProcessor::findRecord(const QString& file, int ordinal) const
+{
+    for (const LogFileInfo& info : _files)
+        if (info.path == file)
+            return ordinal >= 0 && ordinal < info.recordCount ? info.firstRecord + ordinal : -1;
+    return -1;
+}
+
+LogMemoryStats LogProcessor::memoryStats() const
+{
+    // Every heap block has some allocator bookkeeping, 16 bytes is a typical value
+    const qint64 heapOverhead = 16;
+
+    LogMemoryStats stats;
+    stats.recordCount = _log.count();
+    stats.sourceSize = _sourceSize;
+    stats.records = stats.recordCount * qint64(sizeof(LogItem) + heapOverhead);
+    stats.indexes = qint64(sizeof(LogItems)) + _log.items().size() * qint64(sizeof(void*));
+    // Received records are summed while they come and go, they are refreshed on every commit
+    if (_ingest)
+        stats.strings = _ingestStrings;
+    else
+        for (const LogItem* item : _log.items())
+            stats.strings += stringBytes(item);
+    stats.strings += _strings.memoryUsage();
+    stats.indexes += _log.fields()->memoryUsage();
+    stats.caches += _histogram.memoryUsage();
+    if (_params.outOfCore)
+    {
+        stats.pageCache = _pageCache.usage();
+        stats.pageCacheBudget = _pageCache.budget();
+        stats.caches += stats.pageCache;
+    }
+    return stats;
+}
@@ -1,11 +1,21 @@
 #ifndef LOG_PROCESOR_H
 #define LOG_PROCESOR_H
 
+#include <QDateTime>
 #include <QObject>
 #include <QMap>
 #include <QStringList>
 
 #include "LogItem.h"
+#include "LogTextSource.h"
+#include "PerfCounters.h"
+#include "RegexPrefilter.h"
+#include "StringPool.h"
+#include "TimeHistogram.h"
+
+class LineScanner;
+class LogIngestServer;
+class TextDecoder;
 
 //--------------------------------------------------------------------------------------------------
 
@@ -24,6 +34,7 @@ struct LogMarkersParams
 struct LogMarker
 {
     QRegExp regexp;
+    RegexPrefilter prefilter; ///< most lines, e.g. continuations of messages, are rejected by it
     QString marker;
     bool simple;
 
@@ -36,13 +47,44 @@ struct LogMarker
     QString validate() const;
 };
 
+struct LogIngestParams
+{
+    bool enabled = false;
+    quint16 port = 5140;
+    bool tcp = true;
+    bool udp = true;
+
+    /// The oldest records are dropped when any of the budgets is exceeded.
+    int maxRecords = 1000000;
+    qint64 maxBytes = 512 * 1024 * 1024;
+};
+
 struct LogParams
 {
     QString encoding;
     QStringList files;
     LogMarkersParams marker;
 
-    bool ok() const { return !files.empty(); }
+    /// Directory and name filter the files were selected from, new files appearing there are added on reload.
+    QString directory;
+    QString filter;
+    Qt::CaseSensitivity filterCase = Qt::CaseInsensitive;
+    bool recursive = false;
+
+    /// Record texts are not loaded but read from files through a page cache of the given size.
+    bool outOfCore = false;
+    qint64 pageCacheSize = 64 * 1024 * 1024;
+
+    /// Rules extracting user-defined fields from records while parsing.
+    QVector<LogFieldRule> fields;
+
+    /// Field linking records of the same object or session, they are indexed by its values.
+    QString correlationKey;
+
+    /// Records are received from the network instead of reading files.
+    LogIngestParams ingest;
+
+    bool ok() const { return !files.empty() || ingest.enabled; }
 };
 
 //--------------------------------------------------------------------------------------------------
@@ -55,6 +97,16 @@ public:
 
     QString read();
 
+    void setPerfCounters(PerfCounters* perf) { _perf = perf; }
+
+    /// Reads only the first maxBytes of the file, 0 means the whole file.
+    void setMaxBytes(qint64 maxBytes) { _maxBytes = maxBytes; }
+
+    /// Makes byte ranges of lines available to processLine().
+    /// It is only possible for ASCII compatible encodings, read() resets the flag for others.
+    void setTrackOffsets(bool on) { _trackOffsets = on; }
+    bool tracksOffsets() const { return _trackOffsets; }
+
 protected:
     virtual QString processStart() { return QString(); }
     virtual bool processLine(const QString&) { return true; }
@@ -62,9 +114,30 @@ protected:
 
     void addError(const QString& s) { _errors.append(s); }
 
+    /// Byte range of the current line in the file, excluding the line break.
+    qint64 lineStart() const { return _lineStart; }
+    qint64 lineEnd() const { return _lineEnd; }
+
+    PerfCounters* _perf = nullptr;
+
 private:
     QString _file, _encoding;
     QStringList _errors;
+    qint64 _maxBytes = 0;
+    bool _trackOffsets = false;
+    qint64 _lineStart = 0, _lineEnd = 0;
+
+    struct LineBatch;
+    struct LineSplitter;
+    struct Pipeline;
+
+    void readBlocks(QFile& input, TextDecoder* decoder);
+    void readLines(QFile& input, TextDecoder* decoder, const LineScanner& scanner);
+    void readPipelined(QFile& input, TextDecoder* decoder, const LineScanner& scanner);
+    void readStage(QFile* input, Pipeline* pipeline);
+    void decodeStage(Pipeline* pipeline, TextDecoder* decoder, LineScanner scanner);
+    bool processBlock(const QString& text, int& pos, bool last);
+    bool processBatch(const LineBatch& batch);
 };
 
 //--------------------------------------------------------------------------------------------------
@@ -76,6 +149,29 @@ public:
 
     const QMap<LogItem::Type, int>& countByType() const { return _countByType; }
 
+    /// Stops reading when the log has got maxRecords records, 0 means no limit.
+    void setMaxRecords(int maxRecords) { _maxRecords = maxRecords; }
+
+    /// Moments and headers of records are interned into the pool if it is set.
+    void setStringPool(StringPool* pool) { _pool = pool; }
+
+    /// Records are counted in the histogram as they are completed if it is set.
+    void setHistogram(TimeHistogram* histogram) { _histogram = histogram; }
+
+    /// Records get byte ranges in the source instead of texts if it is set.
+    void setTextSource(const LogTextSource* source) { _source = source; setTrackOffsets(source); }
+
+    /// Values found by the rules are stored into fields of the log, the rules must be set there as well.
+    void setFieldRules(const QVector<LogFieldRule>& rules);
+
+    /// Parses lines that do not come from a file, e.g. received from a socket.
+    /// Returns an error message if markers are invalid. Lines out of any record are dropped then.
+    QString beginLines() { _dropOrphanLines = true; return processStart(); }
+    void addLine(const QString& line) { processLine(line); }
+
+    /// Completes the pending record, otherwise it is completed by the next line having a marker.
+    void endRecord() { finishItem(); }
+
 protected:
     QString processStart() override;
     bool processLine(const QString& line) override;
@@ -92,8 +188,60 @@ private:
     LogMarkersParams* _params;
     LogMarker _leftMarker, _rightMarker;
     QMap<LogItem::Type, int> _countByType;
+    int _maxRecords = 0;
+    bool _dropOrphanLines = false;
+    StringPool* _pool = nullptr;
+    TimeHistogram* _histogram = nullptr;
+    const LogTextSource* _source = nullptr;
+    qint64 _messageEnd = 0;
+    QVector<LogFieldRule> _fieldRules;
+    QStringList _fieldValues; ///< values found in lines of the current record, null if not found yet
+    quint32 _perfTicks[PerfCounters::PhaseCount] = {}; ///< calls of phases timed per line or record
 
     void finishItem();
+    void extractFields(const QString& line);
+};
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+    Estimated memory consumed by a loaded dataset, in bytes.
+*/
+struct LogMemoryStats
+{
+    qint64 records = 0;  ///< LogItem structures
+    qint64 strings = 0;  ///< QString payloads referenced by records
+    qint64 indexes = 0;  ///< record lists and lookup structures
+    qint64 caches = 0;   ///< derived data kept to speed up operations
+    qint64 recordCount = 0;
+    qint64 sourceSize = 0;
+    qint64 pageCache = 0;       ///< part of caches holding file pages of out-of-core datasets
+    qint64 pageCacheBudget = 0; ///< 0 when texts are loaded into memory
+
+    qint64 total() const { return records + strings + indexes + caches; }
+    double bytesPerRecord() const { return recordCount > 0 ? total() / double(recordCount) : 0; }
+    double sourceRatio() const { return sourceSize > 0 ? total() / double(sourceSize) : 0; }
+};
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+    Source file of a dataset and the range of its records.
+    Size, modification time and a hash of the head tell if the file has changed since parsing.
+*/
+struct LogFileInfo
+{
+    QString path;
+    qint64 size = 0;
+    QDateTime modified;
+    uint headHash = 0;
+    int firstRecord = 0;
+    int recordCount = 0;
+    QMap<LogItem::Type, int> countByType;
+    LogTextSource* source = nullptr; ///< owned by the processor, set for out-of-core datasets
+
+    static LogFileInfo identify(const QString& path);
+    bool isSame(const LogFileInfo& other) const;
 };
 
 //--------------------------------------------------------------------------------------------------
@@ -104,24 +252,73 @@ class LogProcessor : public QObject
 
 public:
     LogProcessor(QObject* parent = nullptr);
+    ~LogProcessor();
 
     const QString& path() const { return _path; }
     const LogItems* log() const { return &_log; }
     int filesCount() const { return _filesCount; }
     int recordsCount() const { return _log.items().size(); }
     const QMap<LogItem::Type, int>& countByType() const { return _countByType; }
+    PerfCounters* perf() { return &_perf; }
+    qint64 sourceSize() const { return _sourceSize; }
+    const TimeHistogram* histogram() const { return &_histogram; }
+    const StringPool* strings() const { return &_strings; }
+    const LogPageCache* pageCache() const { return &_pageCache; }
+    bool isOutOfCore() const { return _params.outOfCore; }
+    LogMemoryStats memoryStats() const;
 
     bool open(const LogParams& params);
 
+    /// Parses new and changed files of the dataset again, records of unchanged files are kept.
+    /// Records get new indexes, so all record pointers and indexes taken before are invalid.
+    /// Returns false if no file has changed.
+    bool reload();
+
+    /// Starts receiving records from the network instead of reading files.
+    bool listen(const LogParams& params);
+    bool isIngesting() const { return _ingest; }
+    void stopIngest();
+
+    /// Moves records received since the last call into the log dropping the oldest ones over the budget.
+    /// Returns the number of dropped records, indexes of the others are decreased by it.
+    /// Returns -1 if there are no new records.
+    int commitIngested();
+
+    /// File of the record and the position of the record in it, unlike the index it survives reloading.
+    bool locateRecord(int index, QString& file, int& ordinal) const;
+    int findRecord(const QString& file, int ordinal) const;
+
 private:
     QString _path;
     int _filesCount;
+    qint64 _sourceSize = 0;
+    PerfCounters _perf;
+    TimeHistogram _histogram;
+    StringPool _strings;
+    LogPageCache _pageCache;
     LogItems _log;
     LogParams _params;
     QMap<LogItem::Type, int> _countByType;
-
-    QString processFile(const QString& file);
+    QList<LogFileInfo> _files;
+    QStringList _knownFiles;
+    LogIngestServer* _ingest = nullptr;
+    qint64 _ingestBytes = 0;
+    qint64 _ingestStrings = 0; ///< part of _ingestBytes taken by strings of records
+
+    QStringList listDirectory() const;
+    void loadFile(const QString& file);
+    void finishLoading();
+    QString processFile(const QString& file, LogFileInfo& info);
     void addItem(LogItem* item, QStringList& strs);
+    int applyRetention();
+
+signals:
+    /// New records are waiting for commitIngested().
+    void recordsReceived();
+
+    /// The first records of the log are going to be deleted by commitIngested(),
+    /// anything reading them in other threads must be stopped.
+    void recordsAboutToBeDropped();
 };
 
 //--------------------------------------------------------------------------------------------------
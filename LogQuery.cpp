@@ -0,0 +1,1026 @@
+#include "LogQuery.h"
+
+#include <QApplication>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QThread>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <numeric>
+
+namespace {
+
+/**
+    Syntax tree of a query, it only lives while the query is compiled.
+*/
+struct Node
+{
+    enum Type { And, Or, Not, Predicate };
+
+    Type type;
+    int predicate = -1;
+    QList<Node*> children;
+
+    // Estimated for the current order of children
+    double cost = 0;
+    double passRate = 0;
+
+    Node(Type t) : type(t) {}
+    ~Node() { qDeleteAll(children); }
+};
+
+//--------------------------------------------------------------------------------------------------
+
+struct Token
+{
+    enum Type { End, Word, Quoted, Open, Close, And, Or, Not };
+
+    Type type;
+    QString text;
+    int pos;
+};
+
+class Parser
+{
+public:
+    Parser(const QString& s, QVector<LogPredicate>& predicates, const QHash<QString, LogFieldRule::Type>& fields)
+        : _s(s), _predicates(predicates), _fields(fields) {}
+
+    Node* parse()
+    {
+        next();
+        Node* node = parseOr();
+        if (node && _token.type != Token::End)
+            fail(qApp->tr("Unexpected '%1'").arg(_token.text));
+        if (!_error.isEmpty())
+        {
+            delete node;
+            return nullptr;
+        }
+        return node;
+    }
+
+    const QString& error() const { return _error; }
+
+private:
+    const QString& _s;
+    QVector<LogPredicate>& _predicates;
+    const QHash<QString, LogFieldRule::Type>& _fields;
+    int _pos = 0;
+    Token _token;
+    QString _error;
+
+    void fail(const QString& message)
+    {
+        if (_error.isEmpty())
+            _error = qApp->tr("%1 at position %2").arg(message).arg(_token.pos + 1);
+    }
+
+    static bool isDelimiter(QChar c) { return c.isSpace() || c == '(' || c == ')'; }
+
+    QString readQuoted()
+    {
+        // _pos is at the opening quote
+        QString text;
+        _pos++;
+        while (_pos < _s.size())
+        {
+            QChar c = _s.at(_pos++);
+            if (c == '"')
+            {
+                if (_pos < _s.size() && _s.at(_pos) == '"')
+                {
+                    text.append('"');
+                    _pos++;
+                    continue;
+                }
+                return text;
+            }
+            text.append(c);
+        }
+        fail(qApp->tr("Unterminated string"));
+        return text;
+    }
+
+    void next()
+    {
+        while (_pos < _s.size() && _s.at(_pos).isSpace()) _pos++;
+        _token.pos = _pos;
+        _token.text.clear();
+        if (_pos >= _s.size())
+        {
+            _token.type = Token::End;
+            return;
+        }
+
+        QChar c = _s.at(_pos);
+        if (c == '(' || c == ')')
+        {
+            _token.type = c == '(' ? Token::Open : Token::Close;
+            _token.text = c;
+            _pos++;
+            return;
+        }
+        if (c == '"')
+        {
+            _token.type = Token::Quoted;
+            _token.text = readQuoted();
+            return;
+        }
+
+        // A word may contain a quoted value after an operator: text:"a b"
+        while (_pos < _s.size() && !isDelimiter(_s.at(_pos)))
+        {
+            if (_s.at(_pos) == '"')
+                _token.text += '"' + readQuoted().replace('"', "\"\"") + '"';
+            else
+                _token.text += _s.at(_pos++);
+        }
+        _token.type = Token::Word;
+        if (_token.text.compare("AND", Qt::CaseInsensitive) == 0 || _token.text == "&&")
+            _token.type = Token::And;
+        else if (_token.text.compare("OR", Qt::CaseInsensitive) == 0 || _token.text == "||")
+            _token.type = Token::Or;
+        else if (_token.text.compare("NOT", Qt::CaseInsensitive) == 0 || _token.text == "!")
+            _token.type = Token::Not;
+    }
+
+    Node* parseOr()
+    {
+        Node* left = parseAnd();
+        if (!left || _token.type != Token::Or) return left;
+
+        Node* node = new Node(Node::Or);
+        node->children.append(left);
+        while (_token.type == Token::Or)
+        {
+            next();
+            Node* right = parseAnd();
+            if (!right) break;
+            node->children.append(right);
+        }
+        return node;
+    }
+
+    Node* parseAnd()
+    {
+        Node* left = parseNot();
+        if (!left) return nullptr;
+
+        Node* node = nullptr;
+        while (_token.type == Token::And || _token.type == Token::Not || _token.type == Token::Word ||
+               _token.type == Token::Quoted || _token.type == Token::Open)
+        {
+            if (_token.type == Token::And) next();
+            Node* right = parseNot();
+            if (!right) break;
+            if (!node)
+            {
+                node = new Node(Node::And);
+                node->children.append(left);
+            }
+            node->children.append(right);
+        }
+        return node ? node : left;
+    }
+
+    Node* parseNot()
+    {
+        if (_token.type == Token::Not)
+        {
+            next();
+            Node* child = parseNot();
+            if (!child) return nullptr;
+            Node* node = new Node(Node::Not);
+            node->children.append(child);
+            return node;
+        }
+        return parsePrimary();
+    }
+
+    Node* parsePrimary()
+    {
+        switch (_token.type)
+        {
+        case Token::Open:
+        {
+            next();
+            Node* node = parseOr();
+            if (!node) return nullptr;
+            if (_token.type != Token::Close)
+            {
+                fail(qApp->tr("Missing ')'"));
+                delete node;
+                return nullptr;
+            }
+            next();
+            return node;
+        }
+        case Token::Quoted:
+        {
+            LogPredicate p;
+            p.kind = LogPredicate::Text;
+            p.text = _token.text;
+            next();
+            return makePredicate(p);
+        }
+        case Token::Word:
+        {
+            LogPredicate p;
+            if (!parsePredicate(_token.text, p)) return nullptr;
+            next();
+            return makePredicate(p);
+        }
+        case Token::End:
+            fail(qApp->tr("Unexpected end of query"));
+            return nullptr;
+        default:
+            fail(qApp->tr("Unexpected '%1'").arg(_token.text));
+            return nullptr;
+        }
+    }
+
+    Node* makePredicate(const LogPredicate& p)
+    {
+        Node* node = new Node(Node::Predicate);
+        node->predicate = _predicates.size();
+        _predicates.append(p);
+        return node;
+    }
+
+    static QString unquote(const QString& s)
+    {
+        if (s.size() >= 2 && s.startsWith('"') && s.endsWith('"'))
+            return s.mid(1, s.size() - 2).replace("\"\"", "\"");
+        return s;
+    }
+
+    bool parsePredicate(const QString& word, LogPredicate& p)
+    {
+        int len = 0;
+        while (len < word.size() && (word.at(len).isLetterOrNumber() || word.at(len) == '_' || word.at(len) == '.'))
+            len++;
+        QString op;
+        if (len > 0 && word.at(0).isLetter())
+            for (const char* s : { ">=", "<=", ":", ">", "<", "=" })
+                if (word.midRef(len).startsWith(QLatin1String(s)))
+                {
+                    op = s;
+                    break;
+                }
+        if (!op.isEmpty())
+        {
+            QString name = word.left(len).toLower();
+            QString value = unquote(word.mid(len + op.size()));
+
+            if (name == "level" && op == ":")
+                return parseLevels(value, p);
+            if (name == "text" && op == ":")
+                return setText(LogPredicate::Text, value, p);
+            if ((name == "re" || name == "regex") && op == ":")
+                return setRegex(LogPredicate::Regex, value, p);
+            if (name == "header" && op == ":")
+                return setText(LogPredicate::Header, value, p);
+            if (name == "hre" && op == ":")
+                return setRegex(LogPredicate::HeaderRegex, value, p);
+            if (name == "time")
+                return parseTime(op, value, p);
+            if (_fields.contains(name))
+                return parseField(name, _fields.value(name), op, value, p);
+
+            fail(qApp->tr("Unknown field '%1'").arg(word.left(len)));
+            return false;
+        }
+        return setText(LogPredicate::Text, unquote(word), p);
+    }
+
+    bool setText(LogPredicate::Kind kind, const QString& value, LogPredicate& p)
+    {
+        if (value.isEmpty())
+        {
+            fail(qApp->tr("Empty text"));
+            return false;
+        }
+        p.kind = kind;
+        p.text = value;
+        return true;
+    }
+
+    bool setRegex(LogPredicate::Kind kind, const QString& value, LogPredicate& p)
+    {
+        p.kind = kind;
+        p.regex = QRegExp(value);
+        if (value.isEmpty() || !p.regex.isValid())
+        {
+            fail(qApp->tr("Invalid regular expression '%1'").arg(value));
+            return false;
+        }
+        p.prefilter = RegexPrefilter(p.regex);
+        return true;
+    }
+
+    bool parseLevels(const QString& value, LogPredicate& p)
+    {
+        p.kind = LogPredicate::Level;
+        for (const QString& level : value.split(',', QString::SkipEmptyParts))
+        {
+            QString s = level.trimmed().toLower();
+            if (s == "info") p.levels |= 1 << LogItem::Info;
+            else if (s == "warning" || s == "warn") p.levels |= 1 << LogItem::Warning;
+            else if (s == "error") p.levels |= 1 << LogItem::Error;
+            else if (s == "debug") p.levels |= 1 << LogItem::Debug;
+            else if (s != "none")
+            {
+                fail(qApp->tr("Unknown level '%1'").arg(level));
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static LogPredicate::Compare compareOf(const QString& op)
+    {
+        if (op == "<") return LogPredicate::Less;
+        if (op == "<=") return LogPredicate::LessOrEqual;
+        if (op == ">") return LogPredicate::Greater;
+        if (op == ">=") return LogPredicate::GreaterOrEqual;
+        return LogPredicate::Equal;
+    }
+
+    bool parseField(const QString& name, LogFieldRule::Type type, const QString& op, const QString& value, LogPredicate& p)
+    {
+        p.kind = LogPredicate::Field;
+        p.field = name;
+        p.fieldType = type;
+        p.compare = compareOf(op);
+        p.text = value;
+        if (type == LogFieldRule::String) return true;
+
+        bool ok;
+        p.number = value.toDouble(&ok);
+        if (!ok)
+        {
+            fail(qApp->tr("Number expected for field '%1'").arg(name));
+            return false;
+        }
+        p.integer = value.toLongLong(&p.isInteger);
+        return true;
+    }
+
+    bool parseTime(const QString& op, const QString& value, LogPredicate& p)
+    {
+        p.kind = LogPredicate::Time;
+        p.compare = compareOf(op);
+
+        // Missing seconds or time of day are taken as zeros
+        for (const QString& s : { value, value + ":00", value + " 00:00:00" })
+        {
+            p.time = LogItem::parseMoment(QStringRef(&s));
+            if (p.time != LogItem::NoTime) return true;
+        }
+        fail(qApp->tr("Invalid time '%1'").arg(value));
+        return false;
+    }
+};
+
+//--------------------------------------------------------------------------------------------------
+
+void estimate(LogPredicate& p)
+{
+    // Typical costs of tests in nanoseconds, reading the whole record text is the most expensive part
+    switch (p.kind)
+    {
+    case LogPredicate::Level:
+    {
+        int n = 0;
+        for (int t = 0; t < LogItem::TypeCount; t++)
+            if (p.levels & (1 << t)) n++;
+        p.cost = 2;
+        p.passRate = n / double(LogItem::TypeCount);
+        break;
+    }
+    case LogPredicate::Time:
+        p.cost = 2;
+        p.passRate = p.compare == LogPredicate::Equal ? 0.01 : 0.5;
+        break;
+    case LogPredicate::Header:
+        p.cost = 50;
+        p.passRate = 0.2;
+        break;
+    case LogPredicate::HeaderRegex:
+        p.cost = p.prefilter.isEmpty() ? 300 : 100;
+        p.passRate = 0.2;
+        break;
+    case LogPredicate::Text:
+        p.cost = 200;
+        p.passRate = 0.2;
+        break;
+    case LogPredicate::Regex:
+        // Most texts are rejected by the literal search, it costs as much as a substring test
+        p.cost = p.prefilter.isEmpty() ? 1500 : 300;
+        p.passRate = 0.2;
+        break;
+    case LogPredicate::Field:
+        p.cost = 3;
+        p.passRate = p.compare == LogPredicate::Equal ? 0.05 : 0.5;
+        break;
+    }
+}
+
+/**
+    Tests the text with the regex of the predicate after its prefilter.
+    The regex is copied as QString::contains() does, its state is not shared between threads.
+*/
+bool containsRegex(const QString& s, const LogPredicate& p)
+{
+    int from = p.prefilter.startOf(s);
+    if (from < 0) return false;
+    QRegExp regex(p.regex);
+    return regex.indexIn(s, from) >= 0;
+}
+
+template <typename T> bool compareValues(T a, T b, LogPredicate::Compare compare)
+{
+    switch (compare)
+    {
+    case LogPredicate::Less: return a < b;
+    case LogPredicate::LessOrEqual: return a <= b;
+    case LogPredicate::Greater: return a > b;
+    case LogPredicate::GreaterOrEqual: return a >= b;
+    case LogPredicate::Equal: return a == b;
+    }
+    return false;
+}
+
+/**
+    Values are compared as stored: numbers as numbers, equality of strings by pool ids.
+*/
+bool testField(const LogPredicate& p, int row)
+{
+    if (!p.fields || p.column < 0) return false;
+    const LogFieldColumn& c = p.fields->column(p.column);
+    if (row >= c.size() || !c.has(row)) return false;
+
+    switch (c.type)
+    {
+    case LogFieldRule::Int:
+        return p.isInteger
+            ? compareValues(c.ints.at(row), p.integer, p.compare)
+            : compareValues(double(c.ints.at(row)), p.number, p.compare);
+    case LogFieldRule::Double:
+        return compareValues(c.doubles.at(row), p.number, p.compare);
+    case LogFieldRule::String:
+        if (p.compare == LogPredicate::Equal)
+            return c.strings.at(row) == p.valueId;
+        return compareValues(QString::compare(p.fields->strings().string(c.strings.at(row)), p.text), 0, p.compare);
+    }
+    return false;
+}
+
+/**
+    Orders operands of AND by cost per rejected record and operands of OR by cost per
+    accepted record, the order minimizes the expected cost of short-circuit evaluation.
+*/
+void optimize(Node* node, const QVector<LogPredicate>& predicates)
+{
+    const double eps = 1e-6;
+
+    switch (node->type)
+    {
+    case Node::Predicate:
+        node->cost = predicates.at(node->predicate).cost;
+        node->passRate = predicates.at(node->predicate).passRate;
+        return;
+
+    case Node::Not:
+        optimize(node->children.first(), predicates);
+        node->cost = node->children.first()->cost;
+        node->passRate = 1 - node->children.first()->passRate;
+        return;
+
+    case Node::And:
+    case Node::Or:
+    {
+        bool isAnd = node->type == Node::And;
+        for (Node* child : node->children)
+            optimize(child, predicates);
+        std::stable_sort(node->children.begin(), node->children.end(), [isAnd, eps](Node* a, Node* b){
+            double da = isAnd ? 1 - a->passRate : a->passRate;
+            double db = isAnd ? 1 - b->passRate : b->passRate;
+            return a->cost / qMax(da, eps) < b->cost / qMax(db, eps);
+        });
+
+        // Probability to reach the next operand
+        double reach = 1;
+        node->cost = 0;
+        for (Node* child : node->children)
+        {
+            node->cost += reach * child->cost;
+            reach *= isAnd ? child->passRate : 1 - child->passRate;
+        }
+        node->passRate = isAnd ? reach : 1 - reach;
+        return;
+    }
+    }
+}
+
+/**
+    Emits steps for the node so the evaluation jumps to onTrue or onFalse
+    depending on its value. Returns the index of the first step of the node.
+    Children are emitted from the last one, so their targets are already known.
+*/
+int emitSteps(const Node* node, int onTrue, int onFalse, QVector<LogQuery::Step>& steps)
+{
+    switch (node->type)
+    {
+    case Node::Predicate:
+        steps.append({node->predicate, onTrue, onFalse});
+        return steps.size() - 1;
+
+    case Node::Not:
+        return emitSteps(node->children.first(), onFalse, onTrue, steps);
+
+    case Node::And:
+    {
+        int next = onTrue;
+        for (int i = node->children.size()-1; i >= 0; i--)
+            next = emitSteps(node->children.at(i), next, onFalse, steps);
+        return next;
+    }
+
+    case Node::Or:
+    {
+        int next = onFalse;
+        for (int i = node->children.size()-1; i >= 0; i--)
+            next = emitSteps(node->children.at(i), onTrue, next, steps);
+        return next;
+    }
+    }
+    return LogQuery::Reject;
+}
+
+QString targetStr(int target)
+{
+    if (target == LogQuery::Accept) return qApp->tr("accept");
+    if (target == LogQuery::Reject) return qApp->tr("reject");
+    return QString::number(target + 1);
+}
+
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+
+QString LogPredicate::spec() const
+{
+    static const char* ops[] = { "<", "<=", ">", ">=", "=" };
+
+    switch (kind)
+    {
+    case Level:
+    {
+        QStringList names;
+        if (levels & (1 << LogItem::Info)) names << "info";
+        if (levels & (1 << LogItem::Warning)) names << "warning";
+        if (levels & (1 << LogItem::Error)) names << "error";
+        if (levels & (1 << LogItem::Debug)) names << "debug";
+        return "level:" + (names.isEmpty() ? QString("none") : names.join(','));
+    }
+    case Text: return "text:" + LogQuery::quote(text);
+    case Regex: return "re:" + LogQuery::quote(regex.pattern());
+    case Header: return "header:" + LogQuery::quote(text);
+    case HeaderRegex: return "hre:" + LogQuery::quote(regex.pattern());
+    case Time:
+        return QString("time%1").arg(ops[compare]) +
+                LogQuery::quote(QDateTime::fromMSecsSinceEpoch(time, Qt::UTC).toString("yyyy-MM-dd hh:mm:ss.zzz"));
+    case Field:
+        return field + ops[compare] + LogQuery::quote(text);
+    }
+    return QString();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+LogQueryStats::LogQueryStats(int predicateCount)
+    : calls(predicateCount), passes(predicateCount), timedCalls(predicateCount), nsecs(predicateCount),
+      memoized(predicateCount)
+{
+}
+
+void LogQueryStats::merge(const LogQueryStats& other)
+{
+    for (int i = 0; i < calls.size() && i < other.calls.size(); i++)
+    {
+        calls[i] += other.calls.at(i);
+        passes[i] += other.passes.at(i);
+        timedCalls[i] += other.timedCalls.at(i);
+        nsecs[i] += other.nsecs.at(i);
+        memoized[i] += other.memoized.at(i);
+    }
+    records += other.records;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+LogPredicateMemo::Entry& LogPredicateMemo::entry(const QString& spec, const LogItems* items)
+{
+    if (items->generation() != _generation)
+    {
+        _entries.clear();
+        _generation = items->generation();
+        _removed = items->removedCount();
+    }
+    else if (items->removedCount() != _removed)
+    {
+        int count = int(items->removedCount() - _removed);
+        for (Entry& e : _entries)
+        {
+            e.result.removeFirst(count);
+            e.known.removeFirst(count);
+        }
+        _removed = items->removedCount();
+    }
+
+    auto it = _entries.find(spec);
+    if (it == _entries.end())
+    {
+        RecordBits empty(items->count());
+        qint64 needed = 2 * empty.bytes();
+        while (!_entries.isEmpty() && usage() + needed > _budget)
+        {
+            auto oldest = _entries.begin();
+            for (auto e = _entries.begin(); e != _entries.end(); e++)
+                if (e.value().lastUse < oldest.value().lastUse)
+                    oldest = e;
+            _entries.erase(oldest);
+        }
+        it = _entries.insert(spec, Entry());
+        it.value().result = empty;
+        it.value().known = empty;
+    }
+    else if (it.value().result.size() != items->count())
+    {
+        it.value().result.resize(items->count());
+        it.value().known.resize(items->count());
+    }
+    it.value().lastUse = ++_clock;
+    return it.value();
+}
+
+qint64 LogPredicateMemo::usage() const
+{
+    qint64 bytes = 0;
+    for (const Entry& e : _entries)
+        bytes += e.result.bytes() + e.known.bytes();
+    return bytes;
+}
+
+void LogPredicateMemo::clear()
+{
+    _entries.clear();
+    _generation = 0;
+    _removed = 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+QString LogQuery::quote(const QString& s)
+{
+    bool plain = !s.isEmpty();
+    for (const QChar& c : s)
+        if (c.isSpace() || c == '"' || c == '(' || c == ')' || c == ':' || c == '<' || c == '>' || c == '=')
+        {
+            plain = false;
+            break;
+        }
+    if (plain && s.compare("AND", Qt::CaseInsensitive) != 0 && s.compare("OR", Qt::CaseInsensitive) != 0 &&
+            s.compare("NOT", Qt::CaseInsensitive) != 0 && s != "!" && s != "&&" && s != "||")
+        return s;
+    return '"' + QString(s).replace('"', "\"\"") + '"';
+}
+
+QString LogQuery::compile(const QStringList& terms)
+{
+    QVector<LogPredicate> predicates;
+    QVector<Step> steps;
+    int entry = Accept;
+
+    QStringList parsed;
+    QList<Node*> nodes;
+    for (const QString& term : terms)
+    {
+        if (term.trimmed().isEmpty()) continue;
+        Parser parser(term, predicates, _fieldTypes);
+        Node* node = parser.parse();
+        if (!node)
+        {
+            qDeleteAll(nodes);
+            return parser.error();
+        }
+        nodes.append(node);
+        parsed.append(term.trimmed());
+    }
+    QString expression = parsed.size() > 1 ? '(' + parsed.join(") AND (") + ')' : parsed.join(QString());
+
+    if (!nodes.isEmpty())
+    {
+        Node* root = nodes.first();
+        if (nodes.size() > 1)
+        {
+            root = new Node(Node::And);
+            root->children = nodes;
+        }
+
+        for (LogPredicate& p : predicates)
+        {
+            estimate(p);
+            auto it = _learned.constFind(p.spec());
+            if (it != _learned.constEnd())
+            {
+                p.cost = it.value().cost;
+                p.passRate = it.value().passRate;
+            }
+        }
+        optimize(root, predicates);
+        entry = emitSteps(root, Accept, Reject, steps);
+        delete root;
+
+        // Steps are emitted backwards, reversing them makes the evaluation go forward from the first one
+        int last = steps.size() - 1;
+        std::reverse(steps.begin(), steps.end());
+        for (Step& step : steps)
+        {
+            if (step.onTrue >= 0) step.onTrue = last - step.onTrue;
+            if (step.onFalse >= 0) step.onFalse = last - step.onFalse;
+        }
+        entry = last - entry;
+    }
+
+    if (expression != _expression)
+        _lastStats = LogQueryStats();
+    _expression = expression;
+    _predicates = predicates;
+    _steps = steps;
+    _entry = entry;
+    return QString();
+}
+
+void LogQuery::adapt(const LogQueryStats& stats)
+{
+    // Too few calls say little about a predicate, the estimate is kept then
+    const qint64 minCalls = 64;
+
+    if (stats.calls.size() != _predicates.size()) return;
+
+    for (int i = 0; i < _predicates.size(); i++)
+    {
+        if (stats.calls.at(i) < minCalls) continue;
+
+        const LogPredicate& p = _predicates.at(i);
+        Measured m = { p.cost, stats.passes.at(i) / double(stats.calls.at(i)) };
+        if (stats.timedCalls.at(i) > 0)
+            m.cost = stats.nsecs.at(i) / double(stats.timedCalls.at(i));
+        _learned[p.spec()] = m;
+    }
+    _lastStats = stats;
+
+    // The same expression gives the same predicates, so the stats stay valid for the new plan
+    compile(_expression);
+}
+
+QString LogQuery::statsReport() const
+{
+    if (_steps.isEmpty() || _lastStats.records == 0) return QString();
+
+    QStringList lines;
+    lines << QString("%1 %2 %3 %4 %5").arg(qApp->tr("Predicate"), -24)
+             .arg(qApp->tr("Calls"), 10).arg(qApp->tr("Pass"), 7).arg(qApp->tr("ns/call"), 8).arg(qApp->tr("Memo"), 10);
+    qint64 totalCalls = 0;
+    for (const Step& step : _steps)
+    {
+        int i = step.predicate;
+        qint64 calls = _lastStats.calls.value(i);
+        qint64 timed = _lastStats.timedCalls.value(i);
+        totalCalls += calls;
+        QString spec = _predicates.at(i).spec();
+        if (spec.size() > 24) spec = spec.left(23) + QChar(0x2026);
+        lines << QString("%1 %2 %3 %4 %5").arg(spec, -24).arg(calls, 10)
+                 .arg(calls > 0 ? QString::number(100.0 * _lastStats.passes.value(i) / calls, 'f', 1) + '%' : QString("-"), 7)
+                 .arg(timed > 0 ? QString::number(_lastStats.nsecs.value(i) / timed) : QString("-"), 8)
+                 .arg(_lastStats.memoized.value(i), 10);
+    }
+    lines << qApp->tr("%1 records, %2 tests per record")
+             .arg(_lastStats.records).arg(totalCalls / double(_lastStats.records), 0, 'f', 2);
+    lines << qApp->tr("%1 remembered results, %2 KB")
+             .arg(_memo.count()).arg(_memo.usage() / 1024);
+    return lines.join('\n');
+}
+
+bool LogQuery::test(const LogPredicate& p, const LogItem* item, QString& content, bool& contentLoaded)
+{
+    switch (p.kind)
+    {
+    case LogPredicate::Level:
+        return p.levels & (1 << item->type);
+
+    case LogPredicate::Time:
+        if (item->time == LogItem::NoTime) return false;
+        switch (p.compare)
+        {
+        case LogPredicate::Less: return item->time < p.time;
+        case LogPredicate::LessOrEqual: return item->time <= p.time;
+        case LogPredicate::Greater: return item->time > p.time;
+        case LogPredicate::GreaterOrEqual: return item->time >= p.time;
+        case LogPredicate::Equal: return item->time == p.time;
+        }
+        return false;
+
+    case LogPredicate::Field:
+        return testField(p, item->index);
+
+    case LogPredicate::Header:
+        return item->header.contains(p.text, Qt::CaseInsensitive);
+
+    case LogPredicate::HeaderRegex:
+        return containsRegex(item->header, p);
+
+    case LogPredicate::Text:
+    case LogPredicate::Regex:
+        // Texts of out-of-core records are read from disk, only once per record
+        if (!contentLoaded)
+        {
+            content = item->content();
+            contentLoaded = true;
+        }
+        return p.kind == LogPredicate::Text ? content.contains(p.text, Qt::CaseInsensitive) : containsRegex(content, p);
+    }
+    return false;
+}
+
+QVector<int> LogQuery::select(const LogItems* items, LogQueryStats& stats)
+{
+    const int count = items->count();
+    stats.records += count;
+    bindFields(items->fields());
+    if (_steps.isEmpty())
+    {
+        QVector<int> all(count);
+        std::iota(all.begin(), all.end(), 0);
+        return all;
+    }
+
+    // Steps only jump forward, so every step gets all its records before it runs
+    QVector<RecordBits> reach(_steps.size());
+    reach[_entry] = RecordBits(count, true);
+    RecordBits accepted(count);
+    auto route = [&](int target, const RecordBits& records)
+    {
+        if (target == Reject) return;
+        RecordBits& to = target == Accept ? accepted : reach[target];
+        if (to.isEmpty())
+            to = records;
+        else
+            to |= records;
+    };
+
+    for (int s = 0; s < _steps.size(); s++)
+    {
+        RecordBits active;
+        std::swap(active, reach[s]);
+        if (active.isEmpty() || active.none()) continue;
+
+        const Step& step = _steps.at(s);
+        LogPredicateMemo::Entry& memo = _memo.entry(_predicates.at(step.predicate).spec(), items);
+        RecordBits missing = RecordBits::andNot(active, memo.known);
+        if (!missing.none())
+        {
+            evaluate(step.predicate, items, missing, memo.result, stats);
+            memo.known |= missing;
+        }
+        stats.memoized[step.predicate] += active.count() - missing.count();
+
+        route(step.onTrue, active & memo.result);
+        route(step.onFalse, active.andNot(memo.result));
+    }
+    return accepted.indexes();
+}
+
+namespace {
+
+/**
+    Tests a predicate for records of a range of words of a bit set.
+    Ranges of different tasks never share words, so results are written in place.
+*/
+struct PredicateScanner
+{
+    typedef LogQueryStats result_type;
+
+    const LogPredicate* predicate;
+    int predicateIndex;
+    int predicateCount;
+    const QList<LogItem*>* items;
+    const RecordBits* records;
+    quint64* result;
+    int chunkWords;
+
+    LogQueryStats operator()(int firstWord) const
+    {
+        // QRegExp keeps the state of the last match, so each task needs its own copy
+        LogPredicate p = *predicate;
+        LogQueryStats stats(predicateCount);
+        qint64 calls = 0, passes = 0, timedCalls = 0, nsecs = 0;
+        QElapsedTimer timer;
+        int lastWord = qMin(firstWord + chunkWords, records->wordCount());
+        for (int w = firstWord; w < lastWord; w++)
+        {
+            quint64 bits = records->word(w);
+            quint64 hits = 0;
+            for (int b = 0; bits; b++, bits >>= 1)
+            {
+                if (!(bits & 1)) continue;
+                QString content;
+                bool contentLoaded = false;
+                bool timed = calls++ % LogQueryStats::SampleEvery == 0;
+                if (timed) timer.start();
+                bool res = LogQuery::test(p, items->at(w * 64 + b), content, contentLoaded);
+                if (timed)
+                {
+                    nsecs += timer.nsecsElapsed();
+                    timedCalls++;
+                }
+                if (res)
+                {
+                    hits |= quint64(1) << b;
+                    passes++;
+                }
+            }
+            result[w] |= hits;
+        }
+        stats.calls[predicateIndex] = calls;
+        stats.passes[predicateIndex] = passes;
+        stats.timedCalls[predicateIndex] = timedCalls;
+        stats.nsecs[predicateIndex] = nsecs;
+        return stats;
+    }
+};
+
+} // namespace
+
+void LogQuery::evaluate(int predicate, const LogItems* items, const RecordBits& records,
+                        RecordBits& result, LogQueryStats& stats) const
+{
+    // Chunks are whole words, small sets are tested in the calling thread
+    int chunkWords = qMax(256, records.wordCount() / (qMax(1, QThread::idealThreadCount()) * 4));
+    QVector<int> chunks;
+    for (int w = 0; w < records.wordCount(); w += chunkWords)
+        chunks.append(w);
+
+    PredicateScanner scanner{&_predicates.at(predicate), predicate, _predicates.size(),
+                             &items->items(), &records, result.words(), chunkWords};
+    if (chunks.size() == 1)
+    {
+        stats.merge(scanner(0));
+        return;
+    }
+    for (const LogQueryStats& partial : QtConcurrent::blockingMapped<QVector<LogQueryStats>>(chunks, scanner))
+        stats.merge(partial);
+}
+
+void LogQuery::bindFields(const LogFields* fields)
+{
+    for (LogPredicate& p : _predicates)
+        if (p.kind == LogPredicate::Field)
+        {
+            p.fields = fields;
+            p.column = fields->indexOf(p.field);
+            p.valueId = fields->strings().find(p.text);
+        }
+}
+
+bool LogQuery::accept(const LogItem* item) const
+{
+    QString content;
+    bool contentLoaded = false;
+    int pc = _entry;
+    while (pc >= 0)
+    {
+        const Step& step = _steps.at(pc);
+        pc = test(_predicates.at(step.predicate), item, content, contentLoaded) ? step.onTrue : step.onFalse;
+    }
+    return pc == Accept;
+}
+
+QString LogQuery::describe() const
+{
+    if (_steps.isEmpty()) return qApp->tr("Accept all records");
+
+    QStringList lines;
+    for (int i = 0; i < _steps.size(); i++)
+    {
+        const Step& step = _steps.at(i);
+        lines << QString("%1. %2 ? %3 : %4").arg(i + 1)
+                 .arg(_predicates.at(step.predicate).spec(), targetStr(step.onTrue), targetStr(step.onFalse));
+    }
+    return lines.join('\n');
+}
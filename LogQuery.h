@@ -0,0 +1,205 @@
+#ifndef LOG_QUERY_H
+#define LOG_QUERY_H
+
+#include <QHash>
+#include <QRegExp>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "LogItem.h"
+#include "RecordBits.h"
+#include "RegexPrefilter.h"
+
+/**
+    Elementary condition of a query.
+*/
+struct LogPredicate
+{
+    enum Kind { Level, Text, Regex, Header, HeaderRegex, Time, Field };
+    enum Compare { Less, LessOrEqual, Greater, GreaterOrEqual, Equal };
+
+    Kind kind = Text;
+    uint levels = 0;       ///< bit mask of LogItem types for Level
+    QString text;          ///< substring for Text and Header, value for Field
+    QRegExp regex;         ///< for Regex and HeaderRegex
+    RegexPrefilter prefilter; ///< literal of the regex, texts without it are not given to the regex
+    Compare compare = Equal;
+    qint64 time = 0;       ///< for Time
+
+    QString field;         ///< name of a user-defined field for Field
+    LogFieldRule::Type fieldType = LogFieldRule::String;
+    double number = 0;     ///< value of numeric fields
+    qint64 integer = 0;    ///< value of int fields if the value is integer
+    bool isInteger = false;
+
+    // Bound to the fields of the filtered store before evaluation
+    const LogFields* fields = nullptr;
+    int column = -1;
+    int valueId = -1;      ///< id of the string value in the pool of the fields, -1 if no record has it
+
+    double cost = 1;       ///< estimated or measured cost of a test, in nanoseconds
+    double passRate = 0.5; ///< estimated or measured fraction of records passing the test
+
+    /// Canonical text of the predicate in the query language.
+    QString spec() const;
+};
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+    Measurements of predicates taken while a query is evaluated. Calls and passes
+    are counted for every record, timing is only sampled for every SampleEvery-th record.
+*/
+struct LogQueryStats
+{
+    enum { SampleEvery = 16 };
+
+    explicit LogQueryStats(int predicateCount = 0);
+
+    QVector<qint64> calls, passes, timedCalls, nsecs;
+    QVector<qint64> memoized; ///< records answered by remembered results without a test
+    qint64 records = 0;
+
+    void merge(const LogQueryStats& other);
+};
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+    Results of predicates over a records store, remembered by predicate spec,
+    so re-enabling a filter costs bitwise operations instead of a text scan.
+    Entries are filled lazily: only records reaching a predicate in a plan are tested
+    and the known set tells which results are valid. Least recently used entries
+    are dropped when the budget is exceeded.
+*/
+class LogPredicateMemo
+{
+public:
+    struct Entry
+    {
+        RecordBits result;
+        RecordBits known;
+        quint64 lastUse = 0;
+    };
+
+    /// Entry of the predicate for the store, all entries are dropped when records of the store are replaced.
+    /// Results follow records removed from the start, appended records are not known yet.
+    /// The reference is valid until the next call.
+    Entry& entry(const QString& spec, const LogItems* items);
+
+    void setBudget(qint64 bytes) { _budget = bytes; }
+    qint64 usage() const;
+    int count() const { return _entries.size(); }
+    void clear();
+
+private:
+    QHash<QString, Entry> _entries;
+    quint64 _generation = 0;
+    qint64 _removed = 0;
+    quint64 _clock = 0;
+    qint64 _budget = 128 * 1024 * 1024;
+};
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+    Filter query compiled into a flat evaluation plan.
+
+    The language combines predicates with AND, OR, NOT and parentheses,
+    AND can be omitted between adjacent terms:
+
+        level:error,warning AND NOT (text:"timeout" OR re:"retry \d+")
+        header:connect time>="2017-03-01 10:00" time<"2017-03-01 11:00"
+
+    Predicates are 'level:' with a comma separated list of types, 'text:' and 're:' matching
+    the record text, 'header:' and 'hre:' matching the header and 'time' compared with a moment.
+    A bare word or quoted string is the same as 'text:', quotes inside quoted strings are doubled.
+    User-defined fields are compared with their stored values, e.g. 'duration>150' or 'session=a1f'.
+
+    Operands of AND and OR are reordered so cheap predicates that are likely
+    to decide the result run first, and the tree is flattened into a list of steps
+    each having jump targets for the true and false outcomes of its predicate.
+
+    Costs and pass rates are estimated at first. Measurements taken during a pass
+    are fed back by adapt() which reorders the plan for the next pass. What is learned
+    about a predicate is remembered by its spec and survives recompiling the query.
+
+    A whole store is filtered with select() which runs the plan over sets of records:
+    each step splits records reaching it by remembered results of its predicate,
+    testing only records that have not been tested before.
+*/
+class LogQuery
+{
+public:
+    enum { Accept = -1, Reject = -2 };
+
+    struct Step
+    {
+        int predicate;
+        int onTrue;
+        int onFalse;
+    };
+
+    /// Names and types of user-defined fields that can be compared in queries.
+    void setFieldTypes(const QHash<QString, LogFieldRule::Type>& types) { _fieldTypes = types; }
+
+    /// Compiles the expression, the previous plan is kept if it fails.
+    /// Returns an error message or an empty string on success.
+    QString compile(const QString& expression) { return compile(QStringList() << expression); }
+
+    /// Compiles terms combined by AND. Each term is parsed on its own, so it can not close
+    /// a parenthesis opened by another one and change how the others are combined.
+    QString compile(const QStringList& terms);
+
+    const QString& expression() const { return _expression; }
+    bool isEmpty() const { return _steps.isEmpty(); }
+
+    bool accept(const LogItem* item) const;
+
+    /// Indexes of accepted records of the store, measurements of predicates are collected.
+    QVector<int> select(const LogItems* items, LogQueryStats& stats);
+
+    /// Updates costs and pass rates of predicates with measurements of a pass and reorders the plan.
+    void adapt(const LogQueryStats& stats);
+
+    /// Measurements of the last adapted pass, per step of the plan.
+    QString statsReport() const;
+
+    const QVector<LogPredicate>& predicates() const { return _predicates; }
+    const QVector<Step>& steps() const { return _steps; }
+    int entry() const { return _entry; }
+
+    /// Human readable listing of the plan.
+    QString describe() const;
+
+    /// Text of a string in the query language, quoted if needed.
+    static QString quote(const QString& s);
+
+    static bool test(const LogPredicate& p, const LogItem* item, QString& content, bool& contentLoaded);
+
+private:
+    struct Measured
+    {
+        double cost;
+        double passRate;
+    };
+
+    QString _expression;
+    QVector<LogPredicate> _predicates;
+    QVector<Step> _steps;
+    int _entry = Accept;
+    QHash<QString, Measured> _learned;
+    LogQueryStats _lastStats;
+    LogPredicateMemo _memo;
+    QHash<QString, LogFieldRule::Type> _fieldTypes;
+
+    /// Makes field predicates refer to columns of the fields.
+    void bindFields(const LogFields* fields);
+
+    /// Tests the predicate for records of the set and stores passed ones into the result.
+    void evaluate(int predicate, const LogItems* items, const RecordBits& records,
+                  RecordBits& result, LogQueryStats& stats) const;
+};
+
+#endif // LOG_QUERY_H
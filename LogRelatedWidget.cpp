@@ -0,0 +1,109 @@
+#include "LogRelatedWidget.h"
+#include "LogProcessor.h"
+
+#include "helpers/OriLayouts.h"
+#include "helpers/OriWidgets.h"
+
+#include <QAbstractTableModel>
+#include <QFileInfo>
+#include <QHeaderView>
+#include <QLabel>
+#include <QTableView>
+
+namespace {
+
+enum {
+    COL_NUMBER,
+    COL_MOMENT,
+    COL_TYPE,
+    COL_FILE,
+    COL_HEADER,
+    COL_MESSAGE,
+
+    COL_TOTAL
+};
+
+class LogRelatedModel : public QAbstractTableModel
+{
+public:
+    LogRelatedModel(const LogProcessor* processor, const LogView& view) : _processor(processor), _view(view) {}
+
+    int columnCount(const QModelIndex&) const override { return COL_TOTAL; }
+    int rowCount(const QModelIndex&) const override { return _view.count(); }
+
+    QVariant headerData(int section, Qt::Orientation orientation, int role) const override
+    {
+        if (orientation != Qt::Horizontal || role != Qt::DisplayRole) return QVariant();
+        switch (section)
+        {
+        case COL_NUMBER: return tr("Number");
+        case COL_MOMENT: return tr("Time");
+        case COL_TYPE: return tr("Type");
+        case COL_FILE: return tr("File");
+        case COL_HEADER: return tr("Header");
+        case COL_MESSAGE: return tr("Message");
+        }
+        return QVariant();
+    }
+
+    QVariant data(const QModelIndex &index, int role) const override
+    {
+        if (!index.isValid()) return QVariant();
+        const LogItem* item = _view.at(index.row());
+        if (role == Qt::UserRole) return item->index;
+        if (role != Qt::DisplayRole) return QVariant();
+        switch (index.column())
+        {
+        case COL_NUMBER: return item->number();
+        case COL_MOMENT: return item->moment;
+        case COL_TYPE: return item->typeStr();
+        case COL_FILE:
+        {
+            QString file;
+            int ordinal;
+            return _processor->locateRecord(item->index, file, ordinal) ? QFileInfo(file).fileName() : QString();
+        }
+        case COL_HEADER: return item->header;
+        case COL_MESSAGE:
+        {
+            QString text = item->content();
+            int eol = text.indexOf('\n');
+            return eol < 0 ? text : text.left(eol);
+        }
+        }
+        return QVariant();
+    }
+
+private:
+    const LogProcessor* _processor;
+    LogView _view;
+};
+
+} // namespace
+
+LogRelatedWidget::LogRelatedWidget(const LogProcessor* processor, const LogView& view, const QString& key, QWidget *parent)
+    : QWidget(parent)
+{
+    _table = new QTableView;
+    _table->setModel(new LogRelatedModel(processor, view));
+    _table->model()->setParent(this);
+    _table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    _table->setSelectionMode(QAbstractItemView::SingleSelection);
+    _table->verticalHeader()->setVisible(false);
+    _table->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    _table->horizontalHeader()->setSectionResizeMode(QHeaderView::Interactive);
+    _table->horizontalHeader()->setSectionResizeMode(COL_MESSAGE, QHeaderView::Stretch);
+    Ori::Gui::setFontMonospace(_table);
+    connect(_table, SIGNAL(activated(QModelIndex)), this, SLOT(activated(QModelIndex)));
+
+    auto info = new QLabel(tr("Records with %1: %2. Double click a record to go to it.").arg(key).arg(view.count()));
+
+    Ori::Layouts::LayoutV({info, _table}).setMargin(3).useFor(this);
+}
+
+void LogRelatedWidget::activated(const QModelIndex& index)
+{
+    int recordIndex = _table->model()->data(index, Qt::UserRole).toInt();
+    if (recordIndex >= 0)
+        emit recordRequested(recordIndex);
+}
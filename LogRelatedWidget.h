@@ -0,0 +1,36 @@
+#ifndef LOG_RELATED_WIDGET_H
+#define LOG_RELATED_WIDGET_H
+
+#include <QWidget>
+
+#include "LogItem.h"
+
+QT_BEGIN_NAMESPACE
+class QModelIndex;
+class QTableView;
+QT_END_NAMESPACE
+
+class LogProcessor;
+
+/**
+    Records having the same correlation key as a selected one, in log order.
+    Records refer to the store of the processor, the page is closed when records change.
+*/
+class LogRelatedWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    LogRelatedWidget(const LogProcessor* processor, const LogView& view, const QString& key, QWidget *parent = 0);
+
+signals:
+    void recordRequested(int index);
+
+private:
+    QTableView* _table;
+
+private slots:
+    void activated(const QModelIndex& index);
+};
+
+#endif // LOG_RELATED_WIDGET_H
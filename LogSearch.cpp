@@ -0,0 +1,138 @@
+#include "LogSearch.h"
+
+#include <QtConcurrent>
+
+LogSearch::LogSearch(QObject *parent) : QObject(parent)
+{
+}
+
+LogSearch::~LogSearch()
+{
+    stop();
+    _future.waitForFinished();
+}
+
+void LogSearch::start(const LogItems* items, const QString& text, bool useRegex)
+{
+    stop();
+    _future.waitForFinished();
+
+    _items = items;
+    _text = text;
+    _useRegex = useRegex;
+    _hitCount = 0;
+    _hitBits = QBitArray(items ? items->count() : 0);
+    _scanned = 0;
+
+    if (!items || text.isEmpty())
+    {
+        emit hitsFound();
+        emit finished();
+        return;
+    }
+    scanRest();
+}
+
+void LogSearch::update(int removed)
+{
+    if (!_items || _text.isEmpty()) return;
+
+    const int count = _items->count();
+    if (removed > 0)
+    {
+        QBitArray bits(count);
+        _hitCount = 0;
+        for (int i = removed; i < _hitBits.size(); i++)
+            if (_hitBits.testBit(i))
+            {
+                bits.setBit(i - removed);
+                _hitCount++;
+            }
+        _hitBits = bits;
+        _scanned = qMax(0, _scanned - removed);
+    }
+    else
+        _hitBits.resize(count);
+
+    // A running worker takes appended records when it has finished its own
+    if (!_running && _scanned < count)
+        scanRest();
+    emit hitsFound();
+}
+
+void LogSearch::scanRest()
+{
+    _running = true;
+    _scanEnd = _items->count();
+    _future = QtConcurrent::run(this, &LogSearch::scan, _items->items(), _scanned, _text, _useRegex, int(_generation));
+}
+
+void LogSearch::stop()
+{
+    // Outdated workers see the changed generation and quit at the next chunk
+    QMutexLocker locker(&_pendingLock);
+    _generation++;
+    _pending.clear();
+    _running = false;
+}
+
+void LogSearch::scan(QList<LogItem*> list, int from, QString text, bool useRegex, int generation)
+{
+    const int chunkSize = 20000;
+
+    QRegExp regex(text);
+    QVector<int> found;
+    int start = from;
+    do
+    {
+        if (_generation != generation) return;
+
+        int end = qMin(list.size(), start + chunkSize);
+        for (int i = start; i < end; i++)
+        {
+            const QString s = list.at(i)->content();
+            if (useRegex ? regex.indexIn(s) >= 0 : s.contains(text, Qt::CaseInsensitive))
+                found.append(i);
+        }
+        {
+            QMutexLocker locker(&_pendingLock);
+            if (_generation != generation) return;
+            _pending += found;
+        }
+        found.clear();
+        start = end;
+
+        QMetaObject::invokeMethod(this, "takePending", Qt::QueuedConnection,
+                                  Q_ARG(int, generation), Q_ARG(int, start));
+    }
+    while (start < list.size());
+}
+
+void LogSearch::takePending(int generation, int scanned)
+{
+    QVector<int> pending;
+    {
+        QMutexLocker locker(&_pendingLock);
+        if (generation != _generation) return;
+        pending.swap(_pending);
+    }
+    for (int index : pending)
+        if (!_hitBits.testBit(index))
+        {
+            _hitBits.setBit(index);
+            _hitCount++;
+        }
+    _scanned = scanned;
+    emit hitsFound();
+
+    if (scanned >= _scanEnd)
+    {
+        if (_scanned < _items->count())
+        {
+            scanRest();
+            return;
+        }
+        _running = false;
+        emit finished();
+    }
+}
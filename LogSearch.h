@@ -0,0 +1,77 @@
+#ifndef LOG_SEARCH_H
+#define LOG_SEARCH_H
+
+#include <QBitArray>
+#include <QFuture>
+#include <QMutex>
+#include <QObject>
+#include <QRegExp>
+#include <QVector>
+
+#include <atomic>
+
+#include "LogItem.h"
+
+/**
+    Searches record texts in the thread pool. Hits are delivered in portions while the search
+    is running and are marked in a bit array by record index. The table moves between hits
+    in the order of its rows, see LogTableWidget::selectNextHighlighted().
+
+    The worker scans its own copy of the record list, so records can be appended to the store
+    while it runs; they are searched after the others. Records must not be deleted until
+    the search is stopped and its worker has quit.
+*/
+class LogSearch : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LogSearch(QObject *parent = 0);
+    ~LogSearch();
+
+    void start(const LogItems* items, const QString& text, bool useRegex);
+    void stop();
+
+    /// Follows records appended to the store and removed from its start. Hits are shifted down
+    /// by the removed count and only records that have not been searched yet are scanned.
+    /// The search must be stopped before records are removed.
+    void update(int removed);
+
+    /// Waits until a stopped worker quits, records can be released after that.
+    void waitForFinished() { _future.waitForFinished(); }
+
+    const QString& text() const { return _text; }
+    bool useRegex() const { return _useRegex; }
+    bool running() const { return _running; }
+
+    int hitCount() const { return _hitCount; }
+    const QBitArray* hitBits() const { return &_hitBits; }
+    bool isHit(int index) const { return index >= 0 && index < _hitBits.size() && _hitBits.testBit(index); }
+
+signals:
+    void hitsFound();
+    void finished();
+
+private:
+    const LogItems* _items = nullptr;
+    QString _text;
+    bool _useRegex = false;
+    bool _running = false;
+    int _hitCount = 0;
+    QBitArray _hitBits;
+    int _scanned = 0; ///< records before it are searched and their hits are marked
+    int _scanEnd = 0; ///< end of the records given to the worker
+
+    std::atomic<int> _generation{0};
+    QMutex _pendingLock;
+    QVector<int> _pending;
+    QFuture<void> _future;
+
+    void scanRest();
+    void scan(QList<LogItem*> list, int from, QString text, bool useRegex, int generation);
+
+private slots:
+    void takePending(int generation, int scanned);
+};
+
+#endif // LOG_SEARCH_H
@@ -0,0 +1,343 @@
+#include "LogSorter.h"
+#include "RecordBits.h"
+
+#include <QThread>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+namespace {
+
+struct KeyLess
+{
+    const qint64* keys;
+    bool descending;
+
+    bool operator()(int a, int b) const { return descending ? keys[a] > keys[b] : keys[a] < keys[b]; }
+};
+
+/**
+    Sorts a run of the order, runs of different tasks do not overlap.
+*/
+struct RunSorter
+{
+    int* order;
+    int count;
+    int runSize;
+    KeyLess less;
+
+    void operator()(int start) const
+    {
+        std::stable_sort(order + start, order + qMin(start + runSize, count), less);
+    }
+};
+
+/**
+    Merges two adjacent sorted runs of the source into the same place of the target,
+    records of the left run go first among equal keys.
+*/
+struct RunMerger
+{
+    const int* source;
+    int* target;
+    int count;
+    int runSize;
+    KeyLess less;
+
+    void operator()(int start) const
+    {
+        int middle = qMin(start + runSize, count);
+        int end = qMin(start + 2 * runSize, count);
+        std::merge(source + start, source + middle, source + middle, source + end, target + start, less);
+    }
+};
+
+/**
+    Ranks of strings in their sort order, equal strings get equal ranks.
+    Strings are given by ids, so every distinct string takes part in comparisons once.
+*/
+QVector<qint64> rankIds(const QVector<int>& ids, const QVector<const QString*>& strings)
+{
+    QVector<int> distinct;
+    for (int id = 0; id < strings.size(); id++)
+        if (strings.at(id)) distinct.append(id);
+    std::sort(distinct.begin(), distinct.end(), [&strings](int a, int b){ return *strings.at(a) < *strings.at(b); });
+
+    QVector<qint64> rankOfId(strings.size(), -1);
+    for (int r = 0; r < distinct.size(); r++)
+        rankOfId[distinct.at(r)] = r;
+
+    QVector<qint64> keys(ids.size());
+    for (int i = 0; i < ids.size(); i++)
+        keys[i] = ids.at(i) < 0 ? -1 : rankOfId.at(ids.at(i));
+    return keys;
+}
+
+QVector<qint64> headerKeys(const LogItems* items)
+{
+    const QList<LogItem*>& list = items->items();
+    int poolIds = 0;
+    for (const LogItem* item : list)
+        poolIds = qMax(poolIds, item->headerId + 1);
+
+    // Headers that are not interned get ids following the pool ones
+    QHash<QString, int> localIds;
+    QVector<const QString*> strings(poolIds, nullptr);
+    QVector<int> ids(list.size());
+    for (int i = 0; i < list.size(); i++)
+    {
+        const LogItem* item = list.at(i);
+        int id = item->headerId;
+        if (id < 0)
+        {
+            auto it = localIds.constFind(item->header);
+            if (it == localIds.constEnd())
+            {
+                it = localIds.insert(item->header, strings.size());
+                strings.append(nullptr);
+            }
+            id = it.value();
+        }
+        ids[i] = id;
+        if (!strings.at(id)) strings[id] = &item->header;
+    }
+    return rankIds(ids, strings);
+}
+
+/**
+    Maps doubles to integers of the same order, NaN marks missing values and goes first.
+*/
+qint64 doubleKey(double d)
+{
+    if (std::isnan(d)) return std::numeric_limits<qint64>::min();
+    if (d == 0) d = 0; // negative zero equals zero
+    qint64 bits;
+    std::memcpy(&bits, &d, sizeof(bits));
+    return bits >= 0 ? bits : bits ^ std::numeric_limits<qint64>::max();
+}
+
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+
+LogView LogSorter::sort(const LogView& view, Key key, int field, Qt::SortOrder order)
+{
+    const LogItems* items = view.base();
+    if (!items) return view;
+
+    if (key == ByIndex)
+    {
+        if (order == Qt::AscendingOrder) return view;
+        QVector<int> indexes(view.count());
+        for (int i = 0; i < indexes.size(); i++)
+            indexes[i] = view.indexAt(indexes.size() - 1 - i);
+        return LogView(items, indexes);
+    }
+
+    const QVector<int>& all = orderOf(items, key, field, order);
+    if (view.isAll())
+        return LogView(items, all);
+
+    // The order of the whole store is reused, records out of the view are skipped
+    RecordBits visible(items->count());
+    for (int i = 0; i < view.count(); i++)
+        visible.setBit(view.indexAt(i));
+    QVector<int> indexes;
+    indexes.reserve(view.count());
+    for (int index : all)
+        if (visible.testBit(index))
+            indexes.append(index);
+    return LogView(items, indexes);
+}
+
+void LogSorter::clear()
+{
+    _orders.clear();
+    _generation = 0;
+    _removed = 0;
+}
+
+const QVector<int>& LogSorter::orderOf(const LogItems* items, Key key, int field, Qt::SortOrder order)
+{
+    if (items->generation() != _generation)
+    {
+        _orders.clear();
+        _generation = items->generation();
+        _removed = items->removedCount();
+    }
+    else if (items->removedCount() != _removed)
+    {
+        removeFirst(int(items->removedCount() - _removed));
+        _removed = items->removedCount();
+    }
+
+    const bool descending = order == Qt::DescendingOrder;
+    int id = ((field + 1) * 4 + int(key)) * 2 + (descending ? 1 : 0);
+    auto it = _orders.find(id);
+    if (it != _orders.end() && it.value().indexes.size() != items->count())
+    {
+        if (it.value().extendable)
+            extend(it.value(), items, key, field, descending);
+        else
+        {
+            _orders.erase(it);
+            it = _orders.end();
+        }
+    }
+    if (it == _orders.end())
+    {
+        if (_orders.size() >= MaxCached)
+            _orders.clear();
+        Order o;
+        o.extendable = isExtendable(items, key, field);
+        QVector<qint64> keys = makeKeys(items, key, field);
+        o.indexes = sortByKeys(keys, descending);
+        if (o.extendable)
+            o.keys = keys;
+        it = _orders.insert(id, o);
+    }
+    return it.value().indexes;
+}
+
+/**
+    Drops the first records from the cached orders, ranks of strings may change without them,
+    so orders that are not extendable are dropped entirely.
+*/
+void LogSorter::removeFirst(int count)
+{
+    for (auto it = _orders.begin(); it != _orders.end(); )
+    {
+        Order& o = it.value();
+        if (!o.extendable)
+        {
+            it = _orders.erase(it);
+            continue;
+        }
+        o.keys.remove(0, qMin(count, o.keys.size()));
+        QVector<int> indexes;
+        indexes.reserve(o.keys.size());
+        for (int index : o.indexes)
+            if (index >= count)
+                indexes.append(index - count);
+        o.indexes = indexes;
+        ++it;
+    }
+}
+
+/**
+    Keys of appended records are sorted alone and merged after equal keys of the cached order.
+*/
+void LogSorter::extend(Order& order, const LogItems* items, Key key, int field, bool descending)
+{
+    const int from = order.keys.size();
+    order.keys += makeKeys(items, key, field, from);
+    KeyLess less{order.keys.constData(), descending};
+
+    QVector<int> added(order.keys.size() - from);
+    std::iota(added.begin(), added.end(), from);
+    std::stable_sort(added.begin(), added.end(), less);
+
+    QVector<int> indexes(order.keys.size());
+    std::merge(order.indexes.constBegin(), order.indexes.constEnd(),
+               added.constBegin(), added.constEnd(), indexes.begin(), less);
+    order.indexes = indexes;
+}
+
+bool LogSorter::isExtendable(const LogItems* items, Key key, int field)
+{
+    if (key == ByTime) return true;
+    if (key != ByField) return false;
+    const LogFields* fields = items->fields();
+    return field >= 0 && field < fields->count() && fields->column(field).type != LogFieldRule::String;
+}
+
+/**
+    Keys of records starting from the given index, ranks of strings are only made for all records.
+*/
+QVector<qint64> LogSorter::makeKeys(const LogItems* items, Key key, int field, int from)
+{
+    const QList<LogItem*>& list = items->items();
+    QVector<qint64> keys(list.size() - from);
+
+    switch (key)
+    {
+    case ByIndex:
+        std::iota(keys.begin(), keys.end(), from);
+        break;
+
+    case ByTime:
+        for (int i = 0; i < keys.size(); i++)
+            keys[i] = list.at(from + i)->time;
+        break;
+
+    case ByHeader:
+        Q_ASSERT(from == 0);
+        keys = headerKeys(items);
+        break;
+
+    case ByField:
+    {
+        const LogFields* fields = items->fields();
+        if (field < 0 || field >= fields->count()) break;
+        const LogFieldColumn& column = fields->column(field);
+        switch (column.type)
+        {
+        case LogFieldRule::Int:
+            for (int i = 0; i < keys.size(); i++)
+                keys[i] = column.ints.at(from + i);
+            break;
+        case LogFieldRule::Double:
+            for (int i = 0; i < keys.size(); i++)
+                keys[i] = doubleKey(column.doubles.at(from + i));
+            break;
+        case LogFieldRule::String:
+        {
+            Q_ASSERT(from == 0);
+            QVector<const QString*> strings(fields->strings().count(), nullptr);
+            for (int id : column.strings)
+                if (id >= 0 && !strings.at(id))
+                    strings[id] = &fields->strings().string(id);
+            keys = rankIds(column.strings, strings);
+            break;
+        }
+        }
+        break;
+    }
+    }
+    return keys;
+}
+
+/**
+    Runs of the order are sorted in parallel and then merged pairwise,
+    the merges of a level run in parallel as well.
+*/
+QVector<int> LogSorter::sortByKeys(const QVector<qint64>& keys, bool descending)
+{
+    const int count = keys.size();
+    QVector<int> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    if (count < 2) return order;
+
+    KeyLess less{keys.constData(), descending};
+    int threads = qMax(1, QThread::idealThreadCount());
+    int runSize = qMax(64 * 1024, (count + threads - 1) / threads);
+    QVector<int> starts;
+    for (int start = 0; start < count; start += runSize)
+        starts.append(start);
+    QtConcurrent::blockingMap(starts, RunSorter{order.data(), count, runSize, less});
+
+    QVector<int> buffer(count);
+    for (; runSize < count; runSize *= 2)
+    {
+        starts.clear();
+        for (int start = 0; start < count; start += 2 * runSize)
+            starts.append(start);
+        QtConcurrent::blockingMap(starts, RunMerger{order.constData(), buffer.data(), count, runSize, less});
+        order.swap(buffer);
+    }
+    return order;
+}
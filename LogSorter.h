@@ -0,0 +1,52 @@
+#ifndef LOG_SORTER_H
+#define LOG_SORTER_H
+
+#include <QHash>
+#include <QVector>
+
+#include "LogItem.h"
+
+/**
+    Orders records by keys computed once per store: record indexes, moments as
+    milliseconds, ranks of interned strings and values of field columns. Keys are
+    sorted by a parallel merge sort which keeps records with equal keys in log order.
+
+    The order of all records of the store is cached per key, so sorting a view
+    after the filter has changed only drops records that are not in the view.
+    Orders by times and numeric fields follow records appended to the store and removed
+    from its start: keys of new records are sorted alone and merged into the cached order.
+*/
+class LogSorter
+{
+public:
+    enum Key { ByIndex, ByTime, ByHeader, ByField };
+
+    /// Records of the view in the order of the key, field is the column of ByField.
+    LogView sort(const LogView& view, Key key, int field, Qt::SortOrder order);
+
+    void clear();
+
+private:
+    enum { MaxCached = 4 };
+
+    struct Order
+    {
+        QVector<int> indexes;
+        QVector<qint64> keys; ///< kept only if keys of new records do not change keys of others
+        bool extendable = false;
+    };
+
+    quint64 _generation = 0;
+    qint64 _removed = 0;
+    QHash<int, Order> _orders;
+
+    const QVector<int>& orderOf(const LogItems* items, Key key, int field, Qt::SortOrder order);
+    void removeFirst(int count);
+    void extend(Order& order, const LogItems* items, Key key, int field, bool descending);
+
+    static bool isExtendable(const LogItems* items, Key key, int field);
+    static QVector<qint64> makeKeys(const LogItems* items, Key key, int field, int from = 0);
+    static QVector<int> sortByKeys(const QVector<qint64>& keys, bool descending);
+};
+
+#endif // LOG_SORTER_H
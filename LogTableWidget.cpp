@@ -1,16 +1,20 @@
 #include "LogTableWidget.h"
 
 #include "Appearance.h"
+#include "LogSorter.h"
 
 #include "helpers/OriWidgets.h"
 
+#include <QBitArray>
 #include <QDebug>
+#include <QFontMetrics>
 #include <QHeaderView>
 #include <QItemSelection>
-#include <QSortFilterProxyModel>
 #include <QStyledItemDelegate>
 #include <QTableView>
 
+#include <algorithm>
+
 namespace {
 
 enum {
@@ -21,59 +25,84 @@ enum {
     TABLE_COL_COUNT
 };
 
-class LogTableItemDelegate : public QStyledItemDelegate
+inline int textWidth(const QFontMetrics& fm, const QString& text)
 {
-public:
-    const LogItems* items = nullptr;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 11, 0)
+    return fm.horizontalAdvance(text);
+#else
+    return fm.width(text);
+#endif
+}
 
-    LogTableItemDelegate() : QStyledItemDelegate() {}
+} // namespace
 
-    void initStyleOption(QStyleOptionViewItem *option, const QModelIndex &index) const override
-    {
-        static QBrush brushError(Appearance::colorError());
-        static QBrush brushWarning(Appearance::colorWarning());
-        static QBrush brushDebug(Appearance::colorDebug());
+//--------------------------------------------------------------------------------------------------
 
-        QStyledItemDelegate::initStyleOption(option, index);
-        int idx = index.sibling(index.row(), TABLE_COL_INDEX).data().toInt();
-        LogItem* item = items->items().at(idx);
-        switch (item->type)
-        {
-        case LogItem::Error:
-            option->backgroundBrush = brushError;
-            break;
+/**
+    Shows records of a view, sorting is done by the model itself on precomputed keys
+    instead of comparing display values. Rows follow the sorted copy of the view.
+*/
+class LogTableModel : public QAbstractTableModel
+{
+public:
+    LogTableModel(const LogView& view, LogSorter* sorter) : _view(view), _rows(view), _sorter(sorter) {}
 
-        case LogItem::Warning:
-            option->backgroundBrush = brushWarning;
-            break;
+    const LogItem* item(int row) const { return _rows.at(row); }
 
-        case LogItem::Debug:
-            option->backgroundBrush = brushDebug;
-            break;
+    /// Records in the order of rows.
+    const LogView& rows() const { return _rows; }
 
-        case LogItem::Info:
-            break;
-        }
+    int sortColumn() const { return _sortColumn; }
+    Qt::SortOrder sortOrder() const { return _sortOrder; }
 
-        switch (index.column())
+    void setView(const LogView& view)
+    {
+        beginResetModel();
+        _view = view;
+        _rows = arrange();
+        endResetModel();
+    }
+
+    void sort(int column, Qt::SortOrder order) override
+    {
+        emit layoutAboutToBeChanged();
+        QModelIndexList persistent = persistentIndexList();
+        QVector<int> records;
+        for (const QModelIndex& index : persistent)
+            records.append(_rows.indexAt(index.row()));
+
+        _sortColumn = column;
+        _sortOrder = order;
+        _rows = arrange();
+
+        // Only rows of persistent indexes, i.e. the selection and the current one, are looked up
+        if (!persistent.isEmpty())
         {
-        case TABLE_COL_INDEX:
-            option->text = QString::number(item->index+1);
-            option->displayAlignment = Qt::AlignCenter;
-            break;
+            QHash<int, int> rowOfRecord;
+            for (int record : records)
+                rowOfRecord.insert(record, -1);
+            for (int row = 0; row < _rows.count(); row++)
+            {
+                auto it = rowOfRecord.find(_rows.indexAt(row));
+                if (it != rowOfRecord.end()) it.value() = row;
+            }
+            QModelIndexList moved;
+            for (int i = 0; i < persistent.size(); i++)
+            {
+                int row = rowOfRecord.value(records.at(i), -1);
+                moved.append(row < 0 ? QModelIndex() : index(row, persistent.at(i).column()));
+            }
+            changePersistentIndexList(persistent, moved);
         }
+        emit layoutChanged();
     }
-};
 
-//--------------------------------------------------------------------------------------------------
+    /// User-defined fields are shown after the message column.
+    const LogFields* fields() const { return _view.base() ? _view.base()->fields() : nullptr; }
+    int fieldCount() const { return _view.base() ? _view.base()->fields()->count() : 0; }
 
-class LogTableModel : public QAbstractTableModel
-{
-public:
-    LogTableModel(const LogItems* items) : _items(items) {}
-
-    int columnCount(const QModelIndex&) const override { return TABLE_COL_COUNT; }
-    int rowCount(const QModelIndex&) const override { return _items->items().size(); }
+    int columnCount(const QModelIndex&) const override { return TABLE_COL_COUNT + fieldCount(); }
+    int rowCount(const QModelIndex&) const override { return _rows.count(); }
 
     Qt::ItemFlags flags(const QModelIndex &index) const override
     {
@@ -92,51 +121,133 @@ public:
             case TABLE_COL_INDEX: return number;
             case TABLE_COL_MOMENT: return moment;
             case TABLE_COL_MESSAGE: return message;
+            default:
+                if (section - TABLE_COL_COUNT < fieldCount())
+                    return fields()->column(section - TABLE_COL_COUNT).name;
             }
         return QVariant();
     }
 
     QVariant data(const QModelIndex &index, int role) const override
     {
-        LogItem* item = _items->items().at(index.row());
-
         if (index.isValid() && role == Qt::DisplayRole)
+        {
+            const LogItem* item = _rows.at(index.row());
             switch (index.column())
             {
             case TABLE_COL_INDEX: return item->index;
             case TABLE_COL_MOMENT: return item->moment;
             case TABLE_COL_MESSAGE: return item->header;
+            default:
+                // Typed values make the columns sort by numbers rather than by text
+                return fields()->value(index.column() - TABLE_COL_COUNT, item->index);
             }
+        }
+        if (index.isValid() && role == Qt::TextAlignmentRole && index.column() >= TABLE_COL_COUNT &&
+                fields()->column(index.column() - TABLE_COL_COUNT).type != LogFieldRule::String)
+            return int(Qt::AlignRight | Qt::AlignVCenter);
         return QVariant();
     }
 
 private:
-    const LogItems* _items;
+    LogView _view;
+    LogView _rows;
+    LogSorter* _sorter;
+    int _sortColumn = -1;
+    Qt::SortOrder _sortOrder = Qt::AscendingOrder;
+
+    LogView arrange() const
+    {
+        switch (_sortColumn)
+        {
+        case -1: return _view;
+        case TABLE_COL_INDEX: return _sorter->sort(_view, LogSorter::ByIndex, -1, _sortOrder);
+        case TABLE_COL_MOMENT: return _sorter->sort(_view, LogSorter::ByTime, -1, _sortOrder);
+        case TABLE_COL_MESSAGE: return _sorter->sort(_view, LogSorter::ByHeader, -1, _sortOrder);
+        default: return _sorter->sort(_view, LogSorter::ByField, _sortColumn - TABLE_COL_COUNT, _sortOrder);
+        }
+    }
 };
 
 //--------------------------------------------------------------------------------------------------
 
-class LogItemFilterProxyModel : public QSortFilterProxyModel
+namespace {
+
+class LogTableItemDelegate : public QStyledItemDelegate
 {
 public:
-    LogItemFilterProxyModel(const LogItems* items, const LogFilters* filters) : _items(items), _filters(filters) {}
+    const LogTableModel* model = nullptr;
+    const QBitArray* highlighted = nullptr;
+
+    LogTableItemDelegate() : QStyledItemDelegate() {}
 
-protected:
-    bool filterAcceptsRow(int sourceRow, const QModelIndex&) const override
+    void initStyleOption(QStyleOptionViewItem *option, const QModelIndex &index) const override
     {
-        return !_filters || _filters->accept(_items->items().at(sourceRow));
-    }
+        static QBrush brushError(Appearance::colorError());
+        static QBrush brushWarning(Appearance::colorWarning());
+        static QBrush brushDebug(Appearance::colorDebug());
+        static QBrush brushSearchHit(Appearance::colorSearchHit());
+
+        // Records are taken from the model directly, without a data() round trip,
+        // so the base implementation building variants of every role is not called
+        const LogItem* item = model->item(index.row());
+        option->index = index;
+        option->features |= QStyleOptionViewItem::HasDisplay;
+        option->displayAlignment = Qt::AlignLeft | Qt::AlignVCenter;
+        switch (item->type)
+        {
+        case LogItem::Error:
+            option->backgroundBrush = brushError;
+            break;
 
-private:
-    const LogItems* _items;
-    const LogFilters* _filters;
+        case LogItem::Warning:
+            option->backgroundBrush = brushWarning;
+            break;
+
+        case LogItem::Debug:
+            option->backgroundBrush = brushDebug;
+            break;
+
+        case LogItem::Info:
+            break;
+        }
+
+        if (highlighted && item->index < highlighted->size() && highlighted->testBit(item->index))
+            option->backgroundBrush = brushSearchHit;
+
+        switch (index.column())
+        {
+        case TABLE_COL_INDEX:
+            option->text = QString::number(item->index+1);
+            option->displayAlignment = Qt::AlignCenter;
+            break;
+
+        case TABLE_COL_MOMENT:
+            option->text = item->moment;
+            break;
+
+        case TABLE_COL_MESSAGE:
+            option->text = item->header;
+            break;
+
+        default:
+        {
+            int field = index.column() - TABLE_COL_COUNT;
+            const LogFields* fields = model->fields();
+            option->text = fields->text(field, item->index);
+            if (fields->column(field).type != LogFieldRule::String)
+                option->displayAlignment = Qt::AlignRight | Qt::AlignVCenter;
+            break;
+        }
+        }
+    }
 };
 
 } // namespace
 
 //--------------------------------------------------------------------------------------------------
 
-LogTableWidget::LogTableWidget(QWidget *parent) : Ori::TableWidgetBase(parent)
+LogTableWidget::LogTableWidget(QWidget *parent) : Ori::TableWidgetBase(parent), _sorter(new LogSorter)
 {
     //hiddenColumns.append(columnIndexId);
 
@@ -150,9 +261,38 @@ LogTableWidget::~LogTableWidget()
 
 void LogTableWidget::adjustHeader()
 {
-    Ori::Gui::resizeColumnToContent(tableView, TABLE_COL_MOMENT);
+    // resizeColumnToContent() measures every row which takes seconds on millions of records.
+    // Moments usually have the same format, so an evenly spaced sample gives the same width.
+    if (!sourceModel) return;
+
+    const int sampleSize = 1000;
+    const int padding = 12;
+
+    QFontMetrics fm(tableView->font());
+    int count = _items ? _items->count() : 0;
+    int momentWidth = textWidth(fm, sourceModel->headerData(TABLE_COL_MOMENT, Qt::Horizontal, Qt::DisplayRole).toString());
+    if (count > 0)
+    {
+        int step = qMax(1, count / sampleSize);
+        for (int i = 0; i < count; i += step)
+            momentWidth = qMax(momentWidth, textWidth(fm, _items->items().at(i)->moment));
+        momentWidth = qMax(momentWidth, textWidth(fm, _items->items().last()->moment));
+    }
+
+    auto header = tableView->horizontalHeader();
+    header->resizeSection(TABLE_COL_MOMENT, momentWidth + padding);
     Ori::Gui::stretchColumn(tableView, TABLE_COL_MESSAGE);
-    tableView->horizontalHeader()->resizeSection(TABLE_COL_INDEX, 48);
+
+    const LogFields* fields = _items ? _items->fields() : nullptr;
+    for (int f = 0; fields && f < fields->count(); f++)
+    {
+        int width = textWidth(fm, fields->column(f).name);
+        int step = qMax(1, count / sampleSize);
+        for (int i = 0; i < count; i += step)
+            width = qMax(width, textWidth(fm, fields->text(f, i)));
+        header->resizeSection(TABLE_COL_COUNT + f, qMin(width, 300) + padding);
+    }
+    header->resizeSection(TABLE_COL_INDEX, qMax(48, textWidth(fm, QString::number(count)) + padding));
 }
 
 void LogTableWidget::populate(const LogItems *items, const LogFilters* filters)
@@ -162,27 +302,54 @@ void LogTableWidget::populate(const LogItems *items, const LogFilters* filters)
     update();
 }
 
+void LogTableWidget::repopulate(int selectedIndex)
+{
+    int sortColumn = sourceModel ? sourceModel->sortColumn() : -1;
+    Qt::SortOrder sortOrder = sourceModel ? sourceModel->sortOrder() : Qt::AscendingOrder;
+
+    update();
+
+    if (sortColumn >= 0)
+        tableView->sortByColumn(sortColumn, sortOrder);
+    if (selectedIndex >= 0)
+        setSelectedId(selectedIndex);
+}
+
 QAbstractItemModel* LogTableWidget::createTableModel()
 {
     if (sourceModel) delete sourceModel;
-    sourceModel = new LogTableModel(_items);
+    _view = makeFilteredView();
+    sourceModel = new LogTableModel(_view, _sorter.data());
     if (itemDelegate)
-        dynamic_cast<LogTableItemDelegate*>(itemDelegate)->items =_items;
+        dynamic_cast<LogTableItemDelegate*>(itemDelegate)->model = sourceModel;
+    _highlightedRowsValid = false;
+    connect(sourceModel, &QAbstractItemModel::modelReset, this, [this]{ _highlightedRowsValid = false; });
+    connect(sourceModel, &QAbstractItemModel::layoutChanged, this, [this]{ _highlightedRowsValid = false; });
+    return sourceModel;
+}
 
-    proxyModel = new LogItemFilterProxyModel(_items, _filters);
-    proxyModel->setSourceModel(sourceModel);
-    return proxyModel;
+LogView LogTableWidget::makeFilteredView() const
+{
+    if (!_items) return LogView();
+    if (!_filters) return LogView(_items);
+
+    return LogView(_items, _filters->select(_items));
 }
 
 void LogTableWidget::tableCreated()
 {
+    // Fixed row heights keep the view from asking every row for its size hint
+    auto rows = tableView->verticalHeader();
+    rows->setSectionResizeMode(QHeaderView::Fixed);
+    rows->setDefaultSectionSize(QFontMetrics(tableView->font()).height() + 6);
+
     connect(tableView->selectionModel(), SIGNAL(selectionChanged(QItemSelection,QItemSelection)),
             this, SLOT(selectionChanged(QItemSelection,QItemSelection)));
 }
 
 int LogTableWidget::filteredRowCount() const
 {
-    return proxyModel? proxyModel->rowCount(): 0;
+    return sourceModel? sourceModel->rows().count(): 0;
 }
 
 const LogItem* LogTableWidget::selectedItem()
@@ -201,26 +368,82 @@ const LogItem *LogTableWidget::item(int row)
 
 void LogTableWidget::updateFilter()
 {
-    if (!proxyModel) return;
-    proxyModel->invalidate();
+    if (!sourceModel) return;
+    _view = makeFilteredView();
+    sourceModel->setView(_view);
     updateHiddenColumns();
 }
 
-void LogTableWidget::selectionChanged(const QItemSelection&, const QItemSelection&)
+void LogTableWidget::setHighlightedRecords(const QBitArray* records)
 {
-    auto it = selectedItem();
-    if (it) emit onLogItemSelected(it);
+    _highlighted = records;
+    if (itemDelegate)
+        dynamic_cast<LogTableItemDelegate*>(itemDelegate)->highlighted = records;
+    updateHighlighting();
 }
 
-LogItems* LogTableWidget::filteredItems() const
+void LogTableWidget::updateHighlighting()
 {
-    auto items = new LogItems;
-    if (!proxyModel) return items;
+    _highlightedRowsValid = false;
+    if (tableView) tableView->viewport()->update();
+}
 
-    for (int row = 0; row < proxyModel->rowCount(); row++)
+/**
+    Highlighted records are intersected with rows once, so moving between them
+    is a binary search however many of them are filtered out.
+*/
+const QVector<int>& LogTableWidget::highlightedRows()
+{
+    if (!_highlightedRowsValid)
     {
-        int index = proxyModel->data(proxyModel->index(row, TABLE_COL_INDEX)).toInt();
-        items->append(_items->items().at(index));
+        _highlightedRows.clear();
+        if (_highlighted && sourceModel)
+        {
+            const LogView& rows = sourceModel->rows();
+            for (int row = 0; row < rows.count(); row++)
+            {
+                int index = rows.indexAt(row);
+                if (index < _highlighted->size() && _highlighted->testBit(index))
+                    _highlightedRows.append(row);
+            }
+        }
+        _highlightedRowsValid = true;
     }
-    return items;
+    return _highlightedRows;
+}
+
+bool LogTableWidget::selectNextHighlighted()
+{
+    const QVector<int>& rows = highlightedRows();
+    if (rows.isEmpty()) return false;
+    auto it = std::upper_bound(rows.begin(), rows.end(), selectedRow());
+    selectRowAt(it != rows.end() ? *it : rows.first());
+    return true;
+}
+
+bool LogTableWidget::selectPreviousHighlighted()
+{
+    const QVector<int>& rows = highlightedRows();
+    if (rows.isEmpty()) return false;
+    int current = selectedRow();
+    auto it = std::lower_bound(rows.begin(), rows.end(), current < 0 ? filteredRowCount() : current);
+    selectRowAt(it != rows.begin() ? *(it - 1) : rows.last());
+    return true;
+}
+
+void LogTableWidget::selectRowAt(int row)
+{
+    tableView->selectRow(row);
+    tableView->scrollTo(tableView->model()->index(row, 0));
+}
+
+void LogTableWidget::selectionChanged(const QItemSelection&, const QItemSelection&)
+{
+    auto it = selectedItem();
+    if (it) emit onLogItemSelected(it);
+}
+
+LogView LogTableWidget::filteredView() const
+{
+    return sourceModel ? sourceModel->rows() : _view;
 }
@@ -4,12 +4,16 @@
 #include "widgets/OriTableWidgetBase.h"
 #include "LogItem.h"
 
+#include <QScopedPointer>
+
 QT_BEGIN_NAMESPACE
-class QAbstractTableModel;
-class QSortFilterProxyModel;
+class QBitArray;
 class QItemSelection;
 QT_END_NAMESPACE
 
+class LogSorter;
+class LogTableModel;
+
 class LogTableWidget : public Ori::TableWidgetBase
 {
     Q_OBJECT
@@ -20,7 +24,14 @@ public:
 
     void populate(const LogItems *items, const LogFilters *filters);
 
-    LogItems* filteredItems() const;
+    /// Shows records of the reloaded store keeping filters, sort order and the selected record.
+    void repopulate(int selectedIndex);
+
+    /// Records shown in the table, in the current sort order.
+    LogView filteredView() const;
+
+    /// Records shown in the table, in the order of the log.
+    const LogView& visibleView() const { return _view; }
 
     const LogItem* selectedItem();
     const LogItem* item(int row);
@@ -28,6 +39,15 @@ public:
 
     int filteredRowCount() const;
 
+    /// Rows of records marked in the bit array are highlighted, null clears highlighting.
+    void setHighlightedRecords(const QBitArray* records);
+    void updateHighlighting();
+
+    /// Selects the closest highlighted row after or before the selected one in the current
+    /// sort order, wrapping around. Returns false if no row is highlighted.
+    bool selectNextHighlighted();
+    bool selectPreviousHighlighted();
+
 signals:
     void onLogItemSelected(const LogItem*);
 
@@ -39,10 +59,18 @@ protected:
     void tableCreated() override;
 
 private:
-    QAbstractTableModel *sourceModel = nullptr;
-    QSortFilterProxyModel *proxyModel = nullptr;
+    LogTableModel *sourceModel = nullptr;
+    QScopedPointer<LogSorter> _sorter;
     const LogItems* _items = nullptr;
     const LogFilters* _filters = nullptr;
+    LogView _view;
+    const QBitArray* _highlighted = nullptr;
+    QVector<int> _highlightedRows; ///< sorted, valid until rows or highlighted records change
+    bool _highlightedRowsValid = false;
+
+    LogView makeFilteredView() const;
+    const QVector<int>& highlightedRows();
+    void selectRowAt(int row);
 
 private slots:
     void selectionChanged(const QItemSelection &, const QItemSelection &);
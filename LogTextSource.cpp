@@ -0,0 +1,155 @@
+#include "LogTextSource.h"
+#include "TextDecoder.h"
+
+#include <QMutexLocker>
+
+namespace {
+
+// A miss reads this many pages at once, so scans in file order do few large reads
+const int ReadAheadPages = 16;
+
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+
+LogPageCache::LogPageCache(qint64 budget)
+{
+    setBudget(budget);
+}
+
+void LogPageCache::setBudget(qint64 bytes)
+{
+    QMutexLocker locker(&_lock);
+    // Keep at least a read-ahead run cached, otherwise sequential reads thrash
+    _budget = qMax(bytes, qint64(PageSize) * ReadAheadPages * 2);
+    _pages.setMaxCost(int(_budget / 1024));
+}
+
+qint64 LogPageCache::usage() const
+{
+    QMutexLocker locker(&_lock);
+    return qint64(_pages.totalCost()) * 1024;
+}
+
+qint64 LogPageCache::hits() const
+{
+    QMutexLocker locker(&_lock);
+    return _hits;
+}
+
+qint64 LogPageCache::misses() const
+{
+    QMutexLocker locker(&_lock);
+    return _misses;
+}
+
+void LogPageCache::clear()
+{
+    QMutexLocker locker(&_lock);
+    _pages.clear();
+    _hits = 0;
+    _misses = 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+LogTextSource::LogTextSource(const QString& file, const QString& encoding, LogPageCache* cache)
+    : _path(file), _file(file), _cache(cache)
+{
+    {
+        QMutexLocker locker(&_cache->_lock);
+        _fileId = _cache->_nextFileId++;
+    }
+    _decoder.reset(TextDecoder::create(encoding, page(0).left(4)));
+}
+
+LogTextSource::~LogTextSource()
+{
+}
+
+QByteArray LogTextSource::page(qint64 index) const
+{
+    {
+        QMutexLocker locker(&_cache->_lock);
+        auto cached = _cache->_pages.object(LogPageCache::key(_fileId, index));
+        if (cached)
+        {
+            _cache->_hits++;
+            return *cached;
+        }
+        _cache->_misses++;
+    }
+
+    QByteArray run;
+    {
+        QMutexLocker locker(&_fileLock);
+        if (!_file.isOpen() && !_file.open(QIODevice::ReadOnly))
+            return QByteArray();
+        if (!_file.seek(index * LogPageCache::PageSize))
+            return QByteArray();
+        run = _file.read(qint64(LogPageCache::PageSize) * ReadAheadPages);
+    }
+    if (run.isEmpty()) return QByteArray();
+
+    QByteArray result;
+    QMutexLocker locker(&_cache->_lock);
+    for (int pos = 0, i = 0; pos < run.size(); pos += LogPageCache::PageSize, i++)
+    {
+        auto data = new QByteArray(run.mid(pos, LogPageCache::PageSize));
+        if (i == 0) result = *data;
+        _cache->_pages.insert(LogPageCache::key(_fileId, index + i), data, (data->size() + 1023) / 1024);
+    }
+    return result;
+}
+
+QByteArray LogTextSource::bytes(qint64 offset, int length) const
+{
+    QByteArray result;
+    result.reserve(length);
+    qint64 end = offset + length;
+    qint64 pos = offset;
+    while (pos < end)
+    {
+        qint64 index = pos / LogPageCache::PageSize;
+        QByteArray data = page(index);
+        int from = int(pos - index * LogPageCache::PageSize);
+        if (from >= data.size()) break;
+        int count = int(qMin(end - pos, qint64(data.size() - from)));
+        result.append(data.constData() + from, count);
+        pos += count;
+    }
+    return result;
+}
+
+QString LogTextSource::text(qint64 offset, int length) const
+{
+    // Texts are decoded in parallel by filters and searches, the decoder keeps state of its input
+    QScopedPointer<TextDecoder> decoder(_decoder->clone());
+    QByteArray data = bytes(offset, length);
+    QString raw;
+    raw.reserve(data.size());
+    decoder->decode(data.constData(), data.size(), raw);
+    decoder->finish(raw);
+
+    // Fast path for single-line records without '\r'
+    if (raw.indexOf('\n') < 0 && !raw.endsWith('\r'))
+        return raw;
+
+    QString text;
+    text.reserve(raw.size());
+    int pos = 0;
+    while (pos < raw.size())
+    {
+        int end = raw.indexOf('\n', pos);
+        if (end < 0) end = raw.size();
+        int len = end - pos;
+        if (len > 0 && raw.at(end-1) == '\r') len--;
+        if (len > 0)
+        {
+            if (!text.isEmpty()) text.append('\n');
+            text.append(raw.constData() + pos, len);
+        }
+        pos = end + 1;
+    }
+    return text;
+}
@@ -0,0 +1,79 @@
+#ifndef LOG_TEXT_SOURCE_H
+#define LOG_TEXT_SOURCE_H
+
+#include <QByteArray>
+#include <QCache>
+#include <QFile>
+#include <QMutex>
+#include <QScopedPointer>
+#include <QString>
+
+class TextDecoder;
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+    LRU cache of fixed-size file pages shared by all text sources of a dataset.
+    Total size of cached pages is bounded by the budget. Thread-safe.
+*/
+class LogPageCache
+{
+public:
+    enum { PageSize = 64 * 1024 };
+
+    explicit LogPageCache(qint64 budget = 64 * 1024 * 1024);
+
+    void setBudget(qint64 bytes);
+    qint64 budget() const { return _budget; }
+    qint64 usage() const;
+    qint64 hits() const;
+    qint64 misses() const;
+
+    void clear();
+
+private:
+    mutable QMutex _lock;
+    QCache<quint64, QByteArray> _pages; ///< costs are in kilobytes as QCache counts them in int
+    qint64 _budget;
+    qint64 _hits = 0, _misses = 0;
+    int _nextFileId = 0;
+
+    static quint64 key(int fileId, qint64 page) { return (quint64(fileId) << 40) | quint64(page); }
+
+    friend class LogTextSource;
+};
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+    Reads record texts of one log file by their byte ranges through the page cache.
+    Sequential reads are served by read-ahead, so a scan over records in file order
+    turns into large sequential file reads. Thread-safe.
+*/
+class LogTextSource
+{
+public:
+    LogTextSource(const QString& file, const QString& encoding, LogPageCache* cache);
+    ~LogTextSource();
+
+    const QString& file() const { return _path; }
+
+    /// Raw bytes of the range, empty if the file can not be read.
+    QByteArray bytes(qint64 offset, int length) const;
+
+    /// Text of the range as it would be seen by the file reader: lines are joined
+    /// with '\n', trailing '\r' are trimmed and empty lines are skipped.
+    QString text(qint64 offset, int length) const;
+
+private:
+    QString _path;
+    mutable QMutex _fileLock;
+    mutable QFile _file;
+    QScopedPointer<TextDecoder> _decoder; ///< only cloned, every text is decoded by its own copy
+    LogPageCache* _cache;
+    int _fileId;
+
+    QByteArray page(qint64 index) const;
+};
+
+#endif // LOG_TEXT_SOURCE_H
@@ -0,0 +1,467 @@
+#include "LogTextView.h"
+#include "LogItem.h"
+#include "LogTextSource.h"
+#include "Appearance.h"
+
+#include <QApplication>
+#include <QClipboard>
+#include <QContextMenuEvent>
+#include <QMenu>
+#include <QPainter>
+#include <QScrollBar>
+
+#include <cstring>
+
+/**
+    Line index of a text shown by the viewer.
+*/
+class LogTextLines
+{
+public:
+    virtual ~LogTextLines() {}
+
+    int count() const { return _count; }
+    int maxLength() const { return _maxLength; }
+
+    virtual QString line(int index) const = 0;
+
+protected:
+    int _count = 0;
+    int _maxLength = 0;
+};
+
+namespace {
+
+const int Margin = 4;
+const int TabSize = 8;
+const int MaxHighlightsPerLine = 1000;
+
+/**
+    Lines of a text held in memory.
+*/
+class StringLines : public LogTextLines
+{
+public:
+    explicit StringLines(const QString& text) : _text(text)
+    {
+        if (text.isEmpty()) return;
+        int pos = 0;
+        while (pos <= text.size())
+        {
+            int end = text.indexOf('\n', pos);
+            if (end < 0) end = text.size();
+            _starts.append(pos);
+            _maxLength = qMax(_maxLength, end - pos);
+            pos = end + 1;
+        }
+        _count = _starts.size();
+        // The start of a virtual line after the last one simplifies length calculation
+        _starts.append(text.size() + 1);
+    }
+
+    QString line(int index) const override
+    {
+        int start = _starts.at(index);
+        return _text.mid(start, _starts.at(index+1) - 1 - start);
+    }
+
+private:
+    QString _text;
+    QVector<int> _starts;
+};
+
+/**
+    Lines of a record of an out-of-core dataset, they are read from the file on demand.
+    Line ranges are indexed by scanning raw bytes, the text is not decoded until shown.
+*/
+class SourceLines : public LogTextLines
+{
+public:
+    SourceLines(const LogTextSource* source, qint64 offset, int length) : _source(source)
+    {
+        const int chunkSize = 1024 * 1024;
+        const qint64 end = offset + length;
+        qint64 lineStart = offset;
+        char prev = 0;
+        for (qint64 pos = offset; pos < end; pos += chunkSize)
+        {
+            QByteArray chunk = source->bytes(pos, int(qMin(qint64(chunkSize), end - pos)));
+            if (chunk.isEmpty()) break;
+            const char* data = chunk.constData();
+            const char* p = data;
+            const char* e = data + chunk.size();
+            while ((p = static_cast<const char*>(memchr(p, '\n', size_t(e - p)))))
+            {
+                char beforeLf = p > data ? *(p-1) : prev;
+                addLine(lineStart, pos + (p - data) - (beforeLf == '\r' ? 1 : 0));
+                lineStart = pos + (p - data) + 1;
+                p++;
+            }
+            prev = chunk.at(chunk.size()-1);
+        }
+        addLine(lineStart, end);
+        _count = _starts.size();
+    }
+
+    QString line(int index) const override
+    {
+        return _source->text(_starts.at(index), _lengths.at(index));
+    }
+
+private:
+    const LogTextSource* _source;
+    QVector<qint64> _starts;
+    QVector<int> _lengths;
+
+    void addLine(qint64 start, qint64 end)
+    {
+        // Empty lines are skipped by the file reader, they are not a part of record texts
+        if (end <= start) return;
+        _starts.append(start);
+        _lengths.append(int(end - start));
+        _maxLength = qMax(_maxLength, int(end - start));
+    }
+};
+
+QString expandTabs(const QString& s)
+{
+    if (!s.contains('\t')) return s;
+
+    QString res;
+    res.reserve(s.size() + TabSize * 4);
+    for (const QChar& c : s)
+        if (c == '\t')
+            res.append(QString(TabSize - res.size() % TabSize, ' '));
+        else
+            res.append(c);
+    return res;
+}
+
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+
+LogTextView::LogTextView(QWidget *parent) : QAbstractScrollArea(parent)
+{
+    setFocusPolicy(Qt::StrongFocus);
+    viewport()->setBackgroundRole(QPalette::Base);
+    viewport()->setAutoFillBackground(true);
+    viewport()->setCursor(Qt::IBeamCursor);
+}
+
+LogTextView::~LogTextView()
+{
+}
+
+void LogTextView::setItem(const LogItem* item)
+{
+    if (!item)
+        setLines(nullptr);
+    else if (item->source)
+        setLines(new SourceLines(item->source, item->offset, item->length));
+    else
+        setLines(new StringLines(item->text));
+}
+
+void LogTextView::setText(const QString& text)
+{
+    setLines(new StringLines(text));
+}
+
+void LogTextView::clear()
+{
+    setLines(nullptr);
+}
+
+void LogTextView::setLines(LogTextLines* lines)
+{
+    _lines.reset(lines);
+    _anchor = Position();
+    _cursor = Position();
+    _selecting = false;
+    _cachedFirst = -1;
+    _cachedLines.clear();
+    verticalScrollBar()->setValue(0);
+    horizontalScrollBar()->setValue(0);
+    updateScrollBars();
+    viewport()->update();
+}
+
+int LogTextView::lineCount() const
+{
+    return _lines ? _lines->count() : 0;
+}
+
+void LogTextView::setHighlight(const QString& text, bool useRegex)
+{
+    _highlightText = text;
+    _highlightUseRegex = useRegex;
+    _highlightRegex = useRegex ? QRegExp(text) : QRegExp();
+    viewport()->update();
+}
+
+int LogTextView::lineHeight() const
+{
+    return qMax(1, fontMetrics().lineSpacing());
+}
+
+int LogTextView::charWidth() const
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 11, 0)
+    return qMax(1, fontMetrics().horizontalAdvance(QLatin1Char('x')));
+#else
+    return qMax(1, fontMetrics().width(QLatin1Char('x')));
+#endif
+}
+
+int LogTextView::visibleLines() const
+{
+    return qMax(1, viewport()->height() / lineHeight());
+}
+
+int LogTextView::visibleColumns() const
+{
+    return qMax(1, (viewport()->width() - Margin) / charWidth());
+}
+
+void LogTextView::updateScrollBars()
+{
+    int lines = lineCount();
+    int maxLength = _lines ? _lines->maxLength() : 0;
+    for (const QString& s : _cachedLines)
+        maxLength = qMax(maxLength, s.size());
+
+    verticalScrollBar()->setRange(0, qMax(0, lines - visibleLines()));
+    verticalScrollBar()->setPageStep(visibleLines());
+    horizontalScrollBar()->setRange(0, qMax(0, maxLength + 1 - visibleColumns()));
+    horizontalScrollBar()->setPageStep(visibleColumns());
+}
+
+QString LogTextView::displayLine(int line) const
+{
+    if (_cachedFirst >= 0 && line >= _cachedFirst && line < _cachedFirst + _cachedLines.size())
+        return _cachedLines.at(line - _cachedFirst);
+    return expandTabs(_lines->line(line));
+}
+
+void LogTextView::fetchLines(int first, int count)
+{
+    if (first == _cachedFirst && count == _cachedLines.size()) return;
+
+    QStringList lines;
+    lines.reserve(count);
+    for (int i = first; i < first + count; i++)
+        lines.append(displayLine(i));
+    _cachedFirst = first;
+    _cachedLines = lines;
+
+    // Expanded tabs can make lines longer than the index knows
+    int maxLength = 0;
+    for (const QString& s : _cachedLines)
+        maxLength = qMax(maxLength, s.size());
+    if (maxLength + 1 - visibleColumns() > horizontalScrollBar()->maximum())
+        horizontalScrollBar()->setMaximum(maxLength + 1 - visibleColumns());
+}
+
+void LogTextView::paintEvent(QPaintEvent*)
+{
+    if (!_lines) return;
+
+    int first = verticalScrollBar()->value();
+    int count = qMax(0, qMin(visibleLines() + 1, _lines->count() - first));
+    fetchLines(first, count);
+
+    QPainter p(viewport());
+    p.setFont(font());
+
+    const int h = lineHeight();
+    const int w = charWidth();
+    const int ascent = fontMetrics().ascent();
+    const int firstColumn = horizontalScrollBar()->value();
+    const int columns = visibleColumns() + 1;
+
+    Position selFrom = qMin(_anchor, _cursor);
+    Position selTo = qMax(_anchor, _cursor);
+    bool hasSelection = !(selFrom == selTo);
+    QColor selColor = palette().color(QPalette::Highlight);
+    selColor.setAlpha(90);
+    QColor hitColor = Appearance::colorSearchHit();
+
+    for (int i = 0; i < count; i++)
+    {
+        int line = first + i;
+        int y = i * h;
+        const QString& text = _cachedLines.at(i);
+        QString segment = text.mid(firstColumn, columns);
+
+        if (hasSelection && line >= selFrom.line && line <= selTo.line)
+        {
+            int from = line == selFrom.line ? selFrom.column : 0;
+            // The line break of a selected line is shown as one more selected column
+            int to = line == selTo.line ? selTo.column : text.size() + 1;
+            from = qMax(0, from - firstColumn);
+            to = qMin(columns, to - firstColumn);
+            if (to > from)
+                p.fillRect(Margin + from * w, y, (to - from) * w, h, selColor);
+        }
+
+        if (!_highlightText.isEmpty())
+        {
+            int pos = 0;
+            for (int k = 0; k < MaxHighlightsPerLine; k++)
+            {
+                int len;
+                if (_highlightUseRegex)
+                {
+                    pos = _highlightRegex.indexIn(segment, pos);
+                    len = _highlightRegex.matchedLength();
+                }
+                else
+                {
+                    pos = segment.indexOf(_highlightText, pos, Qt::CaseInsensitive);
+                    len = _highlightText.size();
+                }
+                if (pos < 0 || len <= 0) break;
+                p.fillRect(Margin + pos * w, y, len * w, h, hitColor);
+                pos += len;
+            }
+        }
+
+        p.drawText(Margin, y + ascent, segment);
+    }
+}
+
+void LogTextView::resizeEvent(QResizeEvent* event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBars();
+}
+
+void LogTextView::changeEvent(QEvent* event)
+{
+    QAbstractScrollArea::changeEvent(event);
+    if (event->type() == QEvent::FontChange)
+    {
+        updateScrollBars();
+        viewport()->update();
+    }
+}
+
+LogTextView::Position LogTextView::positionAt(const QPoint& pos) const
+{
+    Position res;
+    if (!_lines || _lines->count() == 0) return res;
+
+    res.line = qBound(0, verticalScrollBar()->value() + pos.y() / lineHeight(), _lines->count() - 1);
+    if (pos.y() < 0) res.line = qMax(0, verticalScrollBar()->value() - 1);
+    res.column = qMax(0, horizontalScrollBar()->value() + qRound((pos.x() - Margin) / double(charWidth())));
+    res.column = qMin(res.column, displayLine(res.line).size());
+    return res;
+}
+
+void LogTextView::ensureVisible(int line)
+{
+    auto bar = verticalScrollBar();
+    if (line < bar->value())
+        bar->setValue(line);
+    else if (line >= bar->value() + visibleLines())
+        bar->setValue(line - visibleLines() + 1);
+}
+
+void LogTextView::mousePressEvent(QMouseEvent* event)
+{
+    if (event->button() != Qt::LeftButton)
+    {
+        QAbstractScrollArea::mousePressEvent(event);
+        return;
+    }
+    _cursor = positionAt(event->pos());
+    if (!(event->modifiers() & Qt::ShiftModifier))
+        _anchor = _cursor;
+    _selecting = true;
+    viewport()->update();
+}
+
+void LogTextView::mouseMoveEvent(QMouseEvent* event)
+{
+    if (!_selecting) return;
+    _cursor = positionAt(event->pos());
+    ensureVisible(_cursor.line);
+    viewport()->update();
+}
+
+void LogTextView::mouseReleaseEvent(QMouseEvent* event)
+{
+    Q_UNUSED(event)
+    _selecting = false;
+}
+
+void LogTextView::mouseDoubleClickEvent(QMouseEvent* event)
+{
+    if (event->button() != Qt::LeftButton) return;
+    Position pos = positionAt(event->pos());
+    _anchor.line = pos.line;
+    _anchor.column = 0;
+    _cursor.line = pos.line;
+    _cursor.column = _lines ? displayLine(pos.line).size() : 0;
+    viewport()->update();
+}
+
+void LogTextView::keyPressEvent(QKeyEvent* event)
+{
+    if (event == QKeySequence::Copy)
+        copy();
+    else if (event == QKeySequence::SelectAll)
+        selectAll();
+    else if (event == QKeySequence::MoveToStartOfDocument)
+        verticalScrollBar()->setValue(0);
+    else if (event == QKeySequence::MoveToEndOfDocument)
+        verticalScrollBar()->setValue(verticalScrollBar()->maximum());
+    else if (event == QKeySequence::MoveToStartOfLine)
+        horizontalScrollBar()->setValue(0);
+    else if (event == QKeySequence::MoveToEndOfLine)
+        horizontalScrollBar()->setValue(horizontalScrollBar()->maximum());
+    else
+        QAbstractScrollArea::keyPressEvent(event);
+}
+
+void LogTextView::contextMenuEvent(QContextMenuEvent* event)
+{
+    QMenu menu;
+    menu.addAction(tr("Copy"), this, SLOT(copy()), QKeySequence::Copy)->setEnabled(!(_anchor == _cursor));
+    menu.addAction(tr("Select All"), this, SLOT(selectAll()), QKeySequence::SelectAll);
+    menu.exec(event->globalPos());
+}
+
+QString LogTextView::selectedText() const
+{
+    if (!_lines || _anchor == _cursor) return QString();
+
+    Position from = qMin(_anchor, _cursor);
+    Position to = qMax(_anchor, _cursor);
+    QStringList lines;
+    for (int line = from.line; line <= to.line; line++)
+    {
+        QString s = displayLine(line);
+        int start = line == from.line ? from.column : 0;
+        int end = line == to.line ? to.column : s.size();
+        lines.append(s.mid(start, end - start));
+    }
+    return lines.join('\n');
+}
+
+void LogTextView::copy()
+{
+    QString text = selectedText();
+    if (!text.isEmpty())
+        qApp->clipboard()->setText(text);
+}
+
+void LogTextView::selectAll()
+{
+    if (!_lines || _lines->count() == 0) return;
+    _anchor = Position();
+    _cursor.line = _lines->count() - 1;
+    _cursor.column = displayLine(_cursor.line).size();
+    viewport()->update();
+}
@@ -0,0 +1,83 @@
+#ifndef LOG_TEXT_VIEW_H
+#define LOG_TEXT_VIEW_H
+
+#include <QAbstractScrollArea>
+#include <QRegExp>
+#include <QScopedPointer>
+#include <QStringList>
+
+class LogItem;
+class LogTextLines;
+
+/**
+    Read-only viewer for record texts of any size. Line starts are indexed once
+    and only lines visible in the viewport are fetched and painted, so showing a record
+    takes the same time regardless of its size. Text is selected with the mouse.
+*/
+class LogTextView : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+    explicit LogTextView(QWidget *parent = 0);
+    ~LogTextView();
+
+    void setItem(const LogItem* item);
+    void setText(const QString& text);
+    void clear();
+
+    /// Marks occurrences of the text in visible lines, empty text removes the marks.
+    void setHighlight(const QString& text, bool useRegex);
+
+    int lineCount() const;
+    QString selectedText() const;
+
+public slots:
+    void copy();
+    void selectAll();
+
+protected:
+    void paintEvent(QPaintEvent*) override;
+    void resizeEvent(QResizeEvent* event) override;
+    void changeEvent(QEvent* event) override;
+    void keyPressEvent(QKeyEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+    void mouseMoveEvent(QMouseEvent* event) override;
+    void mouseReleaseEvent(QMouseEvent* event) override;
+    void mouseDoubleClickEvent(QMouseEvent* event) override;
+    void contextMenuEvent(QContextMenuEvent* event) override;
+
+private:
+    struct Position
+    {
+        int line = 0;
+        int column = 0;
+
+        bool operator < (const Position& p) const { return line < p.line || (line == p.line && column < p.column); }
+        bool operator == (const Position& p) const { return line == p.line && column == p.column; }
+    };
+
+    QScopedPointer<LogTextLines> _lines;
+    Position _anchor, _cursor;
+    bool _selecting = false;
+    QString _highlightText;
+    QRegExp _highlightRegex;
+    bool _highlightUseRegex = false;
+
+    // Display lines of the last painted range, they are reused while scrolling horizontally
+    int _cachedFirst = -1;
+    QStringList _cachedLines;
+
+    void setLines(LogTextLines* lines);
+    int lineHeight() const;
+    int charWidth() const;
+    int visibleLines() const;
+    int visibleColumns() const;
+    Position positionAt(const QPoint& pos) const;
+    QString displayLine(int line) const;
+    void fetchLines(int first, int count);
+    void updateScrollBars();
+    void ensureVisible(int line);
+};
+
+#endif // LOG_TEXT_VIEW_H
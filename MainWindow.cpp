@@ -1,10 +1,21 @@
 #include "MainWindow.h"
 #include "LogFilterPanel.h"
+#include "LogFindBar.h"
+#include "LogSearch.h"
+#include "LogTextView.h"
 #include "LogTableWidget.h"
 #include "LogProcessor.h"
 #include "LogItemWidget.h"
+#include "LogPatterns.h"
+#include "LogPatternsWidget.h"
+#include "LogRelatedWidget.h"
+#include "LogExporter.h"
+#include "MemoryPanel.h"
 #include "OpenFilesDialog.h"
+#include "PerformancePanel.h"
 #include "RegexExamWindow.h"
+#include "TimeHistogramWidget.h"
+#include "helpers/OriDialogs.h"
 #include "helpers/OriWindows.h"
 #include "helpers/OriWidgets.h"
 #include "helpers/OriLayouts.h"
@@ -20,13 +31,16 @@
 #include <QDockWidget>
 #include <QInputDialog>
 #include <QFileDialog>
+#include <QFutureWatcher>
 #include <QLabel>
 #include <QMenuBar>
 #include <QMessageBox>
+#include <QProgressDialog>
 #include <QPushButton>
 #include <QStatusBar>
 #include <QTextBrowser>
-#include <QPlainTextEdit>
+#include <QTimer>
+#include <QtConcurrent>
 
 MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
 {
@@ -37,6 +51,17 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
     createStatusBar();
 
     _logTable = new LogTableWidget;
+
+    _findBar = new LogFindBar;
+    _findBar->setVisible(false);
+    connect(_findBar, SIGNAL(searchChanged()), this, SLOT(startSearch()));
+    connect(_findBar, SIGNAL(findNext()), this, SLOT(findNext()));
+    connect(_findBar, SIGNAL(findPrevious()), this, SLOT(findPrevious()));
+    connect(_findBar, SIGNAL(closed()), this, SLOT(stopSearch()));
+
+    _search = new LogSearch(this);
+    connect(_search, SIGNAL(hitsFound()), this, SLOT(searchProgress()));
+    connect(_search, SIGNAL(finished()), this, SLOT(searchProgress()));
     connect(_logTable, SIGNAL(onDoubleClick()), this, SLOT(showSelectedItem()));
     connect(_logTable, SIGNAL(onLogItemSelected(const LogItem*)), this, SLOT(showCurrentItem(const LogItem*)));
 
@@ -56,18 +81,37 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
     addDockWidget(Qt::LeftDockWidgetArea, _dockfilterPanel);
     connect(_filterPanel, SIGNAL(changed()), this, SLOT(updateFilter()));
 
-    _logItemView = new QPlainTextEdit;
+    _logItemView = new LogTextView;
     Ori::Gui::setFontMonospace(_logItemView);
     _dockRecordText = new QDockWidget(tr("Record"));
     _dockRecordText->setFeatures(QDockWidget::DockWidgetMovable | QDockWidget::DockWidgetFloatable | QDockWidget::DockWidgetVerticalTitleBar);
     _dockRecordText->setWidget(_logItemView);
     _dockRecordText->setVisible(false);
     addDockWidget(Qt::BottomDockWidgetArea, _dockRecordText);
+
+    _perfPanel = new PerformancePanel;
+    _dockPerfPanel = new QDockWidget(tr("Performance"));
+    _dockPerfPanel->setFeatures(QDockWidget::DockWidgetMovable | QDockWidget::DockWidgetFloatable | QDockWidget::DockWidgetClosable);
+    _dockPerfPanel->setWidget(_perfPanel);
+    _dockPerfPanel->setVisible(false);
+    addDockWidget(Qt::BottomDockWidgetArea, _dockPerfPanel);
+    tabifyDockWidget(_dockRecordText, _dockPerfPanel);
+
+    _memoryPanel = new MemoryPanel;
+    _dockMemoryPanel = new QDockWidget(tr("Memory"));
+    _dockMemoryPanel->setFeatures(QDockWidget::DockWidgetMovable | QDockWidget::DockWidgetFloatable | QDockWidget::DockWidgetClosable);
+    _dockMemoryPanel->setWidget(_memoryPanel);
+    _dockMemoryPanel->setVisible(false);
+    addDockWidget(Qt::BottomDockWidgetArea, _dockMemoryPanel);
+    tabifyDockWidget(_dockPerfPanel, _dockMemoryPanel);
 }
 
 MainWindow::~MainWindow()
 {
     saveSettings();
+    stopExport();
+    delete _exporter;
+    delete _visibleHistogram;
 }
 
 void MainWindow::loadSettings()
@@ -90,12 +134,27 @@ void MainWindow::createMenu()
 {
     QMenu *menu = menuBar()->addMenu(tr("File"));
     _actionOpenDir = menu->addAction(QIcon(":/open"), tr("Open Logs Directory..."), this, SLOT(openLogsDir()), QKeySequence::Open);
+    _actionReload = menu->addAction(tr("Reload"), this, SLOT(reloadLogs()), QKeySequence::Refresh);
+    _actionExport = menu->addAction(tr("Export Visible Records..."), this, SLOT(exportVisibleRecords()), QKeySequence("Ctrl+E"));
 
     menu = menuBar()->addMenu("Log");
     menu->addAction(tr("Go To Record Number..."), this, SLOT(gotoRecord()), QKeySequence("Ctrl+G"));
+    menu->addSeparator();
+    menu->addAction(tr("Find..."), this, SLOT(showFindBar()), QKeySequence::Find);
+    menu->addAction(tr("Find Next"), this, SLOT(findNext()), QKeySequence::FindNext);
+    menu->addAction(tr("Find Previous"), this, SLOT(findPrevious()), QKeySequence::FindPrevious);
+    menu->addSeparator();
+    menu->addAction(tr("Plot Record Intervals"), this, SLOT(plotRecordIntervals()));
+    menu->addAction(tr("Plot Filtered Record Intervals"), this, SLOT(plotFilteredRecordIntervals()));
+    menu->addAction(tr("Find Message Patterns"), this, SLOT(showPatterns()), QKeySequence("Ctrl+P"));
+    menu->addAction(tr("Show Related Records"), this, SLOT(showRelatedRecords()), QKeySequence("Ctrl+Shift+R"));
 
     menu = menuBar()->addMenu(tr("Tools"));
     menu->addAction(tr("Play With Regex"), this, SLOT(showRegexTool()));
+    menu->addSeparator();
+    menu->addAction(tr("Show Performance"), [this]{ _dockPerfPanel->setVisible(true); _dockPerfPanel->raise(); });
+    menu->addAction(tr("Save Performance Report..."), this, SLOT(savePerfReport()));
+    menu->addAction(tr("Show Memory Usage"), [this]{ _dockMemoryPanel->setVisible(true); _dockMemoryPanel->raise(); });
 }
 
 QBoxLayout* MainWindow::makeStartPageCommand(QAction* action)
@@ -127,7 +186,7 @@ QWidget* MainWindow::createStartPage()
 
 QWidget* MainWindow::createRecordsPage()
 {
-    return Ori::Layouts::LayoutV({_logTable}).setMargin(3).makeWidget();
+    return Ori::Layouts::LayoutV({_findBar, _logTable}).setMargin(3).makeWidget();
 }
 
 void MainWindow::createStatusBar()
@@ -140,6 +199,7 @@ void MainWindow::createStatusBar()
     statusBar()->addWidget(_statusCountError = new QLabel);
     statusBar()->addWidget(_statusCountDebug = new QLabel);
     statusBar()->addWidget(_statusCountVisible = new QLabel);
+    statusBar()->addWidget(_statusPerf = new QLabel);
     statusBar()->addWidget(_statusPath = new QLabel);
 }
 
@@ -169,8 +229,19 @@ void MainWindow::openLogsDir()
 
 void MainWindow::openLogs(const LogParams& params)
 {
+    // An export of the records being replaced is not finished in the background
+    stopExport();
+
+    // The port is taken by the current processor when it receives records too
+    if (_processor && params.ingest.enabled)
+        _processor->stopIngest();
+
     auto processor = new LogProcessor(this);
     if (!processor->open(params)) return;
+    if (_processor)
+        _processor->stopIngest();
+    connect(processor, SIGNAL(recordsReceived()), this, SLOT(commitIngested()));
+    connect(processor, SIGNAL(recordsAboutToBeDropped()), this, SLOT(dropIngested()));
 
     _recentPath.clear();
     closePages();
@@ -179,8 +250,15 @@ void MainWindow::openLogs(const LogParams& params)
         displayEmptyProcessor();
     else
         displayCurrentProcessor();
+    _filterPanel->setFields(_processor->log()->fields());
     _logTable->populate(_processor->log(), _filterPanel->filters());
-    _recentPath = _processor->path();
+    _filterPanel->showStatistics();
+    _recentPath = _processor->isIngesting() ? QString() : _processor->path();
+    _actionReload->setEnabled(!_processor->isIngesting());
+    if (_visibleHistogram)
+        _visibleHistogram->update(_processor->histogram(), _logTable->visibleView());
+    if (_findBar->isVisible())
+        startSearch();
 
     if (_justStarted)
     {
@@ -192,10 +270,86 @@ void MainWindow::openLogs(const LogParams& params)
     }
 }
 
+void MainWindow::reloadLogs()
+{
+    if (!_processor) return;
+
+    // Record indexes change on reload, the selected record is found again by its place in the file
+    QString selectedFile;
+    int selectedOrdinal = -1;
+    auto item = _logTable->selectedItem();
+    if (item) _processor->locateRecord(item->index, selectedFile, selectedOrdinal);
+
+    // Records of changed files are going to be deleted, nothing should refer to them
+    _search->stop();
+    _search->waitForFinished();
+    stopExport();
+    _logItemView->clear();
+    for (int i = _tabs->count()-1; i > 0; i--)
+        if (!qobject_cast<TimeHistogramWidget*>(_tabs->widget(i)))
+            closePage(i);
+
+    if (!_processor->reload())
+    {
+        statusBar()->showMessage(tr("No changes in log files"), 3000);
+        if (_findBar->isVisible()) startSearch();
+        if (item) showCurrentItem(item);
+        return;
+    }
+
+    _logTable->repopulate(_processor->findRecord(selectedFile, selectedOrdinal));
+    _filterPanel->showStatistics();
+    displayCurrentProcessor();
+    updateHistogramPages();
+    if (_findBar->isVisible())
+        startSearch();
+}
+
+/**
+    Shows records received since the last time. The selected record stays
+    selected unless it has been dropped for exceeding the retention budget.
+*/
+void MainWindow::commitIngested()
+{
+    // Records are left staged while the store is being exported, they are taken when it finishes
+    if (!_processor || _exportWatcher) return;
+
+    auto item = _logTable->selectedItem();
+    int selected = item ? item->index : -1;
+
+    int dropped = _processor->commitIngested();
+    if (dropped < 0) return;
+    if (dropped > 0)
+    {
+        // Dropped records are deleted, nothing should refer to them
+        _logItemView->clear();
+        for (int i = _tabs->count()-1; i > 0; i--)
+            if (!qobject_cast<TimeHistogramWidget*>(_tabs->widget(i)))
+                closePage(i);
+        selected = selected >= dropped ? selected - dropped : -1;
+    }
+
+    _logTable->repopulate(selected);
+    _filterPanel->showStatistics();
+    displayCurrentProcessor();
+    updateHistogramPages();
+    // Hits found so far are kept, only new records are searched
+    if (_findBar->isVisible())
+        _search->update(dropped);
+}
+
+void MainWindow::dropIngested()
+{
+    // The search reads records in the thread pool, it goes on with the rest after they are dropped
+    _search->stop();
+    _search->waitForFinished();
+}
+
 void MainWindow::displayEmptyProcessor()
 {
     _statusCountFiles->clear();
     _statusCountTotal->clear();
+    _statusPerf->clear();
     _statusPath->clear();
 }
 
@@ -214,6 +368,15 @@ void MainWindow::displayCurrentProcessor()
     showStatus(_statusCountDebug, tr("Debug:"), _processor->countByType()[LogItem::Debug]);
     showStatus(_statusCountVisible, tr("Visible:"), _logTable->filteredRowCount());
     _statusPath->setText("  " % _processor->path() % "  ");
+    displayPerformance();
+    _memoryPanel->populate(_processor->memoryStats());
+}
+
+void MainWindow::displayPerformance()
+{
+    auto perf = _processor->perf();
+    _statusPerf->setText("  " % perf->summary() % "  ");
+    _perfPanel->populate(perf);
 }
 
 void MainWindow::showSelectedItem()
@@ -262,14 +425,114 @@ LogItemWidget* MainWindow::recordPageById(int id)
 void MainWindow::updateFilter()
 {
     Ori::WaitCursor wc;
-    _logTable->updateFilter();
+    if (!_processor)
+    {
+        _logTable->updateFilter();
+        return;
+    }
+    {
+        PerfTimer timer(_processor->perf(), PerfCounters::Filter);
+        _logTable->updateFilter();
+    }
+    _processor->perf()->addRecords(PerfCounters::Filter, _processor->recordsCount());
+    _filterPanel->showStatistics();
     showStatus(_statusCountVisible, tr("Visible:"), _logTable->filteredRowCount());
+    displayPerformance();
+    updateHistogramPages();
+}
+
+void MainWindow::updateHistogramPages()
+{
+    if (_visibleHistogram)
+        _visibleHistogram->update(_processor->histogram(), _logTable->visibleView());
+    for (int i = 0; i < _tabs->count(); i++)
+    {
+        auto page = qobject_cast<TimeHistogramWidget*>(_tabs->widget(i));
+        if (page) page->update();
+    }
+}
+
+void MainWindow::plotRecordIntervals()
+{
+    if (!_processor) return;
+    auto page = new TimeHistogramWidget(_processor->histogram());
+    _tabs->addTab(page, tr("Record intervals"));
+    _tabs->setCurrentWidget(page);
+}
+
+void MainWindow::plotFilteredRecordIntervals()
+{
+    if (!_processor) return;
+    if (!_visibleHistogram)
+    {
+        _visibleHistogram = new VisibleTimeHistogram;
+        _visibleHistogram->update(_processor->histogram(), _logTable->visibleView());
+    }
+    auto page = new TimeHistogramWidget(_visibleHistogram);
+    _tabs->addTab(page, tr("Filtered record intervals"));
+    _tabs->setCurrentWidget(page);
 }
 
 void MainWindow::showCurrentItem(const LogItem* item)
 {
-    _logItemView->setPlainText(item->text);
+    _logItemView->setItem(item);
     _dockRecordText->setWindowTitle(tr("Record [%1]").arg(item->number()));
+    highlightSearchInRecord();
+}
+
+void MainWindow::highlightSearchInRecord()
+{
+    if (_findBar->isVisible())
+        _logItemView->setHighlight(_search->text(), _search->useRegex());
+    else
+        _logItemView->setHighlight(QString(), false);
+}
+
+void MainWindow::showFindBar()
+{
+    if (!_processor) return;
+    _findBar->activate();
+}
+
+void MainWindow::startSearch()
+{
+    if (!_processor) return;
+    _search->start(_processor->log(), _findBar->text(), _findBar->useRegex());
+    _logTable->setHighlightedRecords(_search->hitBits());
+    highlightSearchInRecord();
+}
+
+void MainWindow::stopSearch()
+{
+    _search->stop();
+    _logTable->setHighlightedRecords(nullptr);
+    highlightSearchInRecord();
+}
+
+void MainWindow::searchProgress()
+{
+    _findBar->showStatus(_search->hitCount(), _search->running());
+    _logTable->updateHighlighting();
+}
+
+void MainWindow::findNext()
+{
+    if (!_findBar->isVisible())
+    {
+        showFindBar();
+        return;
+    }
+    _logTable->selectNextHighlighted();
+}
+
+void MainWindow::findPrevious()
+{
+    if (!_findBar->isVisible())
+    {
+        showFindBar();
+        return;
+    }
+    _logTable->selectPreviousHighlighted();
 }
 
 void MainWindow::showRegexTool()
@@ -277,6 +540,58 @@ void MainWindow::showRegexTool()
     (new RegexExamWindow)->show();
 }
 
+void MainWindow::showPatterns()
+{
+    if (!_processor) return;
+
+    Ori::WaitCursor wc;
+    auto patterns = new LogPatterns;
+    patterns->build(_logTable->visibleView());
+
+    auto page = new LogPatternsWidget(patterns);
+    connect(page, SIGNAL(recordRequested(int)), this, SLOT(showRecord(int)));
+    _tabs->addTab(page, tr("Patterns"));
+    _tabs->setCurrentWidget(page);
+}
+
+/**
+    Opens records having the same correlation key as the selected one.
+    They are taken from the key index, records are not scanned.
+*/
+void MainWindow::showRelatedRecords()
+{
+    if (!_processor) return;
+    auto item = _logTable->selectedItem();
+    if (!item) return;
+
+    const LogItems* log = _processor->log();
+    const LogFields* fields = log->fields();
+    if (fields->keyColumn() < 0)
+    {
+        Ori::Dlg::info(tr("Correlation key is not set. Set it on the tab 'Format' when opening logs."));
+        return;
+    }
+    QVector<int> related = fields->related(item->index);
+    QString name = fields->column(fields->keyColumn()).name;
+    if (related.isEmpty())
+    {
+        statusBar()->showMessage(tr("The record has no value of '%1'").arg(name), 3000);
+        return;
+    }
+
+    QString key = QString("%1=%2").arg(name, fields->text(fields->keyColumn(), item->index));
+    auto page = new LogRelatedWidget(_processor, LogView(log, related), key);
+    connect(page, SIGNAL(recordRequested(int)), this, SLOT(showRecord(int)));
+    _tabs->addTab(page, key);
+    _tabs->setCurrentWidget(page);
+}
+
+void MainWindow::showRecord(int index)
+{
+    _tabs->setCurrentIndex(0);
+    _logTable->setSelectedId(index);
+}
+
 void MainWindow::gotoRecord()
 {
     static int savedIndex = 0;
@@ -287,3 +602,83 @@ void MainWindow::gotoRecord()
         _logTable->setSelectedId(index-1);
     }
 }
+
+void MainWindow::savePerfReport()
+{
+    if (!_processor) return;
+
+    auto fileName = QFileDialog::getSaveFileName(this, tr("Save Performance Report"),
+        _recentPath, tr("JSON files (*.json);;All files (*.*)"));
+    if (fileName.isEmpty()) return;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        Ori::Dlg::error(tr("Unable to save file %1: %2").arg(fileName, file.errorString()));
+        return;
+    }
+    file.write(_processor->perf()->toJson());
+}
+
+void MainWindow::exportVisibleRecords()
+{
+    if (!_processor || _exportWatcher) return;
+
+    QString textFilter = tr("Text files (*.txt *.log)");
+    QString csvFilter = tr("CSV files (*.csv)");
+    QString jsonFilter = tr("JSON lines (*.jsonl)");
+    QString selectedFilter;
+    auto fileName = QFileDialog::getSaveFileName(this, tr("Export Visible Records"), _recentPath,
+        QStringList({textFilter, csvFilter, jsonFilter}).join(";;"), &selectedFilter);
+    if (fileName.isEmpty()) return;
+
+    auto format = LogExporter::PlainText;
+    if (selectedFilter == csvFilter) format = LogExporter::Csv;
+    else if (selectedFilter == jsonFilter) format = LogExporter::JsonLines;
+
+    // The exporter reads records of the store in another thread,
+    // so commands changing the store are unavailable until it finishes
+    auto exporter = new LogExporter(_logTable->filteredView(), format);
+    _exporter = exporter;
+    _actionOpenDir->setEnabled(false);
+    _actionReload->setEnabled(false);
+    _actionExport->setEnabled(false);
+
+    auto progress = new QProgressDialog(tr("Exporting records..."), tr("Cancel"), 0, exporter->totalCount(), this);
+    progress->setWindowModality(Qt::WindowModal);
+    progress->setMinimumDuration(500);
+    connect(progress, &QProgressDialog::canceled, [exporter]{ exporter->cancel(); });
+
+    auto timer = new QTimer(progress);
+    connect(timer, &QTimer::timeout, [progress, exporter]{ progress->setValue(exporter->exportedCount()); });
+    timer->start(100);
+
+    auto watcher = new QFutureWatcher<QString>(this);
+    _exportWatcher = watcher;
+    connect(watcher, &QFutureWatcher<QString>::finished, [this, watcher, progress, exporter, fileName]{
+        QString res = watcher->result();
+        progress->deleteLater();
+        watcher->deleteLater();
+        delete exporter;
+        _exporter = nullptr;
+        _exportWatcher = nullptr;
+        _actionOpenDir->setEnabled(true);
+        _actionReload->setEnabled(_processor && !_processor->isIngesting());
+        _actionExport->setEnabled(true);
+        if (_processor && _processor->isIngesting())
+            commitIngested();
+        if (!res.isEmpty())
+            Ori::Dlg::error(tr("Unable to export records to %1: %2").arg(fileName, res));
+    });
+    watcher->setFuture(QtConcurrent::run([exporter, fileName]{ return exporter->exportTo(fileName); }));
+}
+
+/**
+    Cancels a running export and waits until it stops reading records.
+*/
+void MainWindow::stopExport()
+{
+    if (!_exportWatcher) return;
+    _exporter->cancel();
+    _exportWatcher->waitForFinished();
+}
@@ -7,16 +7,23 @@
 QT_BEGIN_NAMESPACE
 class QBoxLayout;
 class QLabel;
-class QPlainTextEdit;
+template <typename T> class QFutureWatcher;
 QT_END_NAMESPACE
 
+class LogExporter;
 class LogItem;
 class LogFilterPanel;
+class LogFindBar;
+class LogSearch;
+class LogTextView;
 class LogTableWidget;
 class LogParams;
 class LogProcessor;
 class LogItemWidget;
+class MemoryPanel;
+class PerformancePanel;
 class QuestWidget;
+class VisibleTimeHistogram;
 
 class MainWindow : public QMainWindow
 {
@@ -30,14 +37,22 @@ private:
     QTabWidget *_tabs;
     LogTableWidget *_logTable;
     LogFilterPanel *_filterPanel;
+    LogFindBar *_findBar;
+    LogSearch *_search;
     LogProcessor *_processor = nullptr;
     QLabel *_statusPath, *_statusCountFiles, *_statusCountTotal, *_statusCountVisible;
     QLabel *_statusCountInfo, *_statusCountWarning, *_statusCountError, *_statusCountDebug;
+    QLabel *_statusPerf;
     bool _justStarted = true;
     QString _recentPath;
-    QPlainTextEdit* _logItemView;
-    QDockWidget *_dockRecordText, *_dockfilterPanel;
-    QAction *_actionOpenDir;
+    LogTextView* _logItemView;
+    PerformancePanel* _perfPanel;
+    MemoryPanel* _memoryPanel;
+    QDockWidget *_dockRecordText, *_dockfilterPanel, *_dockPerfPanel, *_dockMemoryPanel;
+    QAction *_actionOpenDir, *_actionReload, *_actionExport;
+    VisibleTimeHistogram* _visibleHistogram = nullptr;
+    LogExporter* _exporter = nullptr;
+    QFutureWatcher<QString>* _exportWatcher = nullptr;
 
     void createMenu();
     void createStatusBar();
@@ -47,6 +62,7 @@ private:
 
     void displayEmptyProcessor();
     void displayCurrentProcessor();
+    void displayPerformance();
 
     LogItemWidget* recordPage(int i);
     LogItemWidget* recordPageById(int id);
@@ -59,9 +75,15 @@ private:
     void openLogs(const LogParams &params);
 
     void showStatus(QLabel* place, const QString& name, int value);
+    void updateHistogramPages();
+    void highlightSearchInRecord();
+    void stopExport();
 
 private slots:
     void openLogsDir();
+    void reloadLogs();
+    void commitIngested();
+    void dropIngested();
     void showSelectedItem();
     //void showAboutBox();
     void tabCloseRequested(int index);
@@ -69,8 +91,19 @@ private slots:
     void showCurrentItem(const LogItem*);
     void showRegexTool();
     void gotoRecord();
-    //void plotRecordIntervals();
-    //void plotFilteredRecordIntervals();
+    void savePerfReport();
+    void exportVisibleRecords();
+    void plotRecordIntervals();
+    void plotFilteredRecordIntervals();
+    void showPatterns();
+    void showRelatedRecords();
+    void showRecord(int index);
+    void showFindBar();
+    void startSearch();
+    void stopSearch();
+    void searchProgress();
+    void findNext();
+    void findPrevious();
 };
 
 #endif // MAIN_WINDOW_H
@@ -0,0 +1,72 @@
+#include "MemoryPanel.h"
+#include "LogProcessor.h"
+
+#include "helpers/OriLayouts.h"
+
+#include <QHeaderView>
+#include <QTableWidget>
+
+namespace {
+
+enum {
+    ROW_RECORDS,
+    ROW_STRINGS,
+    ROW_INDEXES,
+    ROW_CACHES,
+    ROW_PAGE_CACHE,
+    ROW_TOTAL,
+    ROW_PER_RECORD,
+    ROW_SOURCE,
+    ROW_RATIO,
+
+    ROW_COUNT
+};
+
+QString formatBytes(qint64 bytes)
+{
+    if (bytes < 1024) return QString::number(bytes) + " B";
+    if (bytes < 1024 * 1024) return QString::number(bytes / 1024.0, 'f', 1) + " KB";
+    if (bytes < 1024 * 1024 * 1024) return QString::number(bytes / 1048576.0, 'f', 1) + " MB";
+    return QString::number(bytes / 1073741824.0, 'f', 2) + " GB";
+}
+
+} // namespace
+
+MemoryPanel::MemoryPanel(QWidget *parent) : QWidget(parent)
+{
+    _table = new QTableWidget(ROW_COUNT, 1);
+    _table->horizontalHeader()->setVisible(false);
+    _table->horizontalHeader()->setStretchLastSection(true);
+    _table->verticalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    _table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    _table->setSelectionMode(QAbstractItemView::NoSelection);
+
+    Ori::Layouts::LayoutV({_table}).setMargin(3).useFor(this);
+}
+
+void MemoryPanel::setRow(int row, const QString& title, const QString& value)
+{
+    auto header = _table->verticalHeaderItem(row);
+    if (!header) _table->setVerticalHeaderItem(row, header = new QTableWidgetItem);
+    header->setText(title);
+
+    auto it = _table->item(row, 0);
+    if (!it) _table->setItem(row, 0, it = new QTableWidgetItem);
+    it->setText(value);
+    it->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+}
+
+void MemoryPanel::populate(const LogMemoryStats& stats)
+{
+    setRow(ROW_RECORDS, tr("Record structures"), formatBytes(stats.records));
+    setRow(ROW_STRINGS, tr("String payloads"), formatBytes(stats.strings));
+    setRow(ROW_INDEXES, tr("Indexes"), formatBytes(stats.indexes));
+    setRow(ROW_CACHES, tr("Caches"), formatBytes(stats.caches));
+    setRow(ROW_PAGE_CACHE, tr("Page cache"), stats.pageCacheBudget > 0
+           ? tr("%1 of %2").arg(formatBytes(stats.pageCache), formatBytes(stats.pageCacheBudget))
+           : tr("Not used"));
+    setRow(ROW_TOTAL, tr("Total"), formatBytes(stats.total()));
+    setRow(ROW_PER_RECORD, tr("Bytes per record"), QString::number(stats.bytesPerRecord(), 'f', 1));
+    setRow(ROW_SOURCE, tr("Source files size"), formatBytes(stats.sourceSize));
+    setRow(ROW_RATIO, tr("Memory / source ratio"), QString::number(stats.sourceRatio(), 'f', 2));
+}
@@ -0,0 +1,27 @@
+#ifndef MEMORY_PANEL_H
+#define MEMORY_PANEL_H
+
+#include <QWidget>
+
+QT_BEGIN_NAMESPACE
+class QTableWidget;
+QT_END_NAMESPACE
+
+struct LogMemoryStats;
+
+class MemoryPanel : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit MemoryPanel(QWidget *parent = 0);
+
+    void populate(const LogMemoryStats& stats);
+
+private:
+    QTableWidget* _table;
+
+    void setRow(int row, const QString& title, const QString& value);
+};
+
+#endif // MEMORY_PANEL_H
@@ -10,27 +10,38 @@
 #include <QDebug>
 #include <QDialogButtonBox>
 #include <QFileDialog>
+#include <QFutureWatcher>
 #include <QGroupBox>
+#include <QLineEdit>
 #include <QListWidget>
 #include <QPlainTextEdit>
 #include <QPushButton>
+#include <QSpinBox>
 #include <QTabWidget>
 #include <QToolButton>
+#include <QtConcurrent>
+
+#include <algorithm>
 
 #define TAB_LOG_FORMAT 1
 
+#define PREVIEW_MAX_LINES 100
+#define PREVIEW_MAX_BYTES (64 * 1024)
+#define TEST_PARSING_MAX_RECORDS 1000
+#define TEST_PARSING_MAX_BYTES (1024 * 1024)
+
 //--------------------------------------------------------------------------------------------------
 
-PreviewFileReader::PreviewFileReader(QPlainTextEdit* target, int maxLines, const QString& file, const QString& encoding)
-    : FileReader(file, encoding), _target(target), _maxLines(maxLines)
+PreviewFileReader::PreviewFileReader(int maxLines, const QString& file, const QString& encoding)
+    : FileReader(file, encoding), _maxLines(maxLines)
 {
+    setMaxBytes(PREVIEW_MAX_BYTES);
 }
 
 bool PreviewFileReader::processLine(const QString& line)
 {
-    auto text = _target->toPlainText();
-    _target->setPlainText(text.isEmpty()? line: (text + "\n" + line));
-    return ++_lineCount < _maxLines;
+    _lines.append(line);
+    return _lines.size() < _maxLines;
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -124,10 +135,18 @@ OpenFilesDialog::OpenFilesDialog(QWidget *parent) : QDialog(parent)
                               0
                           })
                       }),
+                      _filesInfo = new QLabel,
                       Ori::Gui::layoutH({
                           new QLabel(tr("Filter:")),
                           _filterEdit = new PersistentCombo("Filter"),
                           _caseSensitiveFiles = new QCheckBox(tr("Case sensitive file list")),
+                          _recursive = new QCheckBox(tr("Include subdirectories")),
+                          0
+                      }),
+                      Ori::Gui::layoutH({
+                          _outOfCore = new QCheckBox(tr("Keep record texts on disk")),
+                          new QLabel(tr("Page cache, MB:")),
+                          _pageCacheSize = new QSpinBox,
                           0
                       })
                   }),
@@ -152,6 +171,15 @@ OpenFilesDialog::OpenFilesDialog(QWidget *parent) : QDialog(parent)
                           _rightMarkerRegexp = new QCheckBox(tr("Regex"))
                       }),
                       Ori::Gui::defaultSpacing(),
+                      new HeaderLabel(tr("Fields:")),
+                      _fieldRules = new QPlainTextEdit,
+                      Ori::Gui::layoutH
+                      ({
+                          new QLabel(tr("Correlation key field:")),
+                          _correlationKey = new QLineEdit,
+                          0
+                      }),
+                      Ori::Gui::defaultSpacing(),
                       new HeaderLabel(tr("Preview:")),
                       _logPreviewTitle = new QLabel(tr("(Select a file on the tab 'Files' to preview)")),
                       _logPreview = new QPlainTextEdit,
@@ -164,20 +192,72 @@ OpenFilesDialog::OpenFilesDialog(QWidget *parent) : QDialog(parent)
                       _parseResults = new QPlainTextEdit
                   }),
                  tr("Format"));
+    tabs->addTab(Ori::Gui::widgetV
+                 ({
+                      _ingest = new QCheckBox(tr("Receive records from the network instead of reading files")),
+                      Ori::Gui::defaultSpacing(),
+                      Ori::Gui::layoutH
+                      ({
+                          new QLabel(tr("Local port:")),
+                          _ingestPort = new QSpinBox,
+                          _ingestTcp = new QCheckBox(tr("TCP")),
+                          _ingestUdp = new QCheckBox(tr("UDP")),
+                          0
+                      }),
+                      Ori::Gui::defaultSpacing(),
+                      new HeaderLabel(tr("Keep at most:")),
+                      Ori::Gui::layoutH
+                      ({
+                          new QLabel(tr("Records, thousands:")),
+                          _ingestMaxRecords = new QSpinBox,
+                          new QLabel(tr("Memory, MB:")),
+                          _ingestMaxMB = new QSpinBox,
+                          0
+                      }),
+                      0
+                  }),
+                 tr("Listen"));
 
     _filterEdit->setPreferredWidth(150);
+    _outOfCore->setToolTip(tr("Only a compact index of records is kept in memory, "
+                              "texts are read from files on demand. Use it for logs larger than RAM."));
+    _pageCacheSize->setRange(4, 64 * 1024);
+    _pageCacheSize->setEnabled(false);
+    connect(_outOfCore, SIGNAL(toggled(bool)), _pageCacheSize, SLOT(setEnabled(bool)));
+    _ingest->setToolTip(tr("Lines are received on the local port, newline-delimited or syslog frames over TCP\n"
+                           "and one message per datagram over UDP. They are parsed with markers and fields\n"
+                           "of the tab 'Format'. The oldest records are dropped when a limit is exceeded."));
+    _ingestPort->setRange(1, 65535);
+    _ingestMaxRecords->setRange(1, 100 * 1000);
+    _ingestMaxMB->setRange(16, 64 * 1024);
     _leftMarkerRegexp->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Maximum);
     _rightMarkerRegexp->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Maximum);
     Ori::Gui::setFontMonospace(_leftMarker);
     Ori::Gui::setFontMonospace(_rightMarker);
     Ori::Gui::setFontMonospace(_logPreview);
     Ori::Gui::setFontMonospace(_parseResults);
+    Ori::Gui::setFontMonospace(_fieldRules);
+    _fieldRules->setMaximumHeight(_fieldRules->fontMetrics().height() * 6);
+    _fieldRules->setPlaceholderText("duration:double = re:took (\\d+\\.?\\d*) ms\n"
+                                    "doctype:int = key:Document type ID");
+    _fieldRules->setToolTip(tr("One rule per line: name[:type] = re:<regex> or name[:type] = key:<key>.\n"
+                               "A regex captures the value in its first group, a key matches 'key=value' or 'key: value'.\n"
+                               "Types are int, double and string. Fields are shown as table columns\n"
+                               "and compared in queries like 'duration>150' or 'doctype=12'."));
+    _correlationKey->setToolTip(tr("Name of a field identifying an object or a session, e.g. a document ID.\n"
+                                   "Records having the same value are shown by 'Show Related Records'."));
     _logPreview->setReadOnly(true);
     _parseResults->setReadOnly(true);
 
     _listFiles->setAlternatingRowColors(true);
     _listFiles->setSelectionMode(QAbstractItemView::MultiSelection);
 
+    _filterEdit->setToolTip(tr("Wildcards separated by semicolons or spaces, e.g. *.log;*.txt"));
+
+    _scanner = new FileScanner(this);
+    connect(_scanner, SIGNAL(filesFound()), this, SLOT(scannedFilesFound()));
+    connect(_scanner, SIGNAL(finished()), this, SLOT(scanFinished()));
+
     auto buttons = new QDialogButtonBox(QDialogButtonBox::Open | QDialogButtonBox::Cancel);
     connect(buttons, &QDialogButtonBox::accepted, this, &QDialog::accept);
     connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
@@ -189,7 +269,9 @@ OpenFilesDialog::OpenFilesDialog(QWidget *parent) : QDialog(parent)
     connect(_comboPath, SIGNAL(currentTextChanged(QString)), this, SLOT(populateFileList()));
     connect(_filterEdit, SIGNAL(editTextChanged(QString)), this, SLOT(filterChanged()));
     connect(tabs, SIGNAL(currentChanged(int)), this, SLOT(tabActivated(int)));
-    connect(_caseSensitiveFiles, SIGNAL(clicked(bool)), this, SLOT(populateFileList()));
+    connect(_caseSensitiveFiles, SIGNAL(clicked(bool)), this, SLOT(filterFileList()));
+    connect(_recursive, SIGNAL(clicked(bool)), this, SLOT(populateFileList()));
+    connect(_listFiles, SIGNAL(itemSelectionChanged()), this, SLOT(updateFilesInfo()));
 }
 
 OpenFilesDialog::~OpenFilesDialog()
@@ -218,6 +300,17 @@ void OpenFilesDialog::saveState()
     s.settings()->setValue("LeftMarkerRegexp", selectedLeftMarkerRegexp());
     s.settings()->setValue("RightMarkerRegexp", selectedRightMarkerRegexp());
     s.settings()->setValue("CaseSensitiveFiles", _caseSensitiveFiles->isChecked());
+    s.settings()->setValue("RecursiveFiles", _recursive->isChecked());
+    s.settings()->setValue("OutOfCore", _outOfCore->isChecked());
+    s.settings()->setValue("PageCacheMB", _pageCacheSize->value());
+    s.settings()->setValue("FieldRules", _fieldRules->toPlainText());
+    s.settings()->setValue("CorrelationKey", _correlationKey->text());
+    s.settings()->setValue("Ingest", _ingest->isChecked());
+    s.settings()->setValue("IngestPort", _ingestPort->value());
+    s.settings()->setValue("IngestTcp", _ingestTcp->isChecked());
+    s.settings()->setValue("IngestUdp", _ingestUdp->isChecked());
+    s.settings()->setValue("IngestMaxRecordsK", _ingestMaxRecords->value());
+    s.settings()->setValue("IngestMaxMB", _ingestMaxMB->value());
 }
 
 void OpenFilesDialog::restoreState()
@@ -229,6 +322,7 @@ void OpenFilesDialog::restoreState()
     _comboPath->load(s.settings());
     _filterEdit->load(s.settings(), "*.log");
     _caseSensitiveFiles->setChecked(s.settings()->value("CaseSensitiveFiles").toBool());
+    _recursive->setChecked(s.settings()->value("RecursiveFiles").toBool());
     populateFileList();
 
     _leftMarker->load(s.settings());
@@ -238,6 +332,19 @@ void OpenFilesDialog::restoreState()
     _rightMarkerRegexp->setChecked(s.settings()->value("RightMarkerRegexp").toBool());
 
     _encoding->load(s.settings(), "UTF-8");
+
+    _outOfCore->setChecked(s.settings()->value("OutOfCore").toBool());
+    _pageCacheSize->setValue(s.settings()->value("PageCacheMB", 256).toInt());
+    _fieldRules->setPlainText(s.settings()->value("FieldRules").toString());
+    _correlationKey->setText(s.settings()->value("CorrelationKey").toString());
+
+    LogIngestParams ingest;
+    _ingest->setChecked(s.settings()->value("Ingest").toBool());
+    _ingestPort->setValue(s.settings()->value("IngestPort", ingest.port).toInt());
+    _ingestTcp->setChecked(s.settings()->value("IngestTcp", ingest.tcp).toBool());
+    _ingestUdp->setChecked(s.settings()->value("IngestUdp", ingest.udp).toBool());
+    _ingestMaxRecords->setValue(s.settings()->value("IngestMaxRecordsK", ingest.maxRecords / 1000).toInt());
+    _ingestMaxMB->setValue(s.settings()->value("IngestMaxMB", ingest.maxBytes / 1024 / 1024).toInt());
 }
 
 LogParams OpenFilesDialog::result() const
@@ -245,10 +352,54 @@ LogParams OpenFilesDialog::result() const
     LogParams params;
     params.encoding = selectedEncoding();
     params.files = selectedFiles();
+    params.directory = selectedDir();
+    params.filter = selectedFilter();
+    params.filterCase = _caseSensitiveFiles->isChecked()? Qt::CaseSensitive: Qt::CaseInsensitive;
+    params.recursive = _recursive->isChecked();
     params.marker = selectedMarkerParams();
+    params.outOfCore = _outOfCore->isChecked();
+    params.pageCacheSize = qint64(_pageCacheSize->value()) * 1024 * 1024;
+    params.fields = selectedFieldRules();
+    params.correlationKey = _correlationKey->text().trimmed().toLower();
+    params.ingest.enabled = _ingest->isChecked();
+    params.ingest.port = quint16(_ingestPort->value());
+    params.ingest.tcp = _ingestTcp->isChecked();
+    params.ingest.udp = _ingestUdp->isChecked();
+    params.ingest.maxRecords = _ingestMaxRecords->value() * 1000;
+    params.ingest.maxBytes = qint64(_ingestMaxMB->value()) * 1024 * 1024;
     return params;
 }
 
+void OpenFilesDialog::accept()
+{
+    QVector<LogFieldRule> rules;
+    QString error = LogFieldRule::parse(_fieldRules->toPlainText(), rules);
+    if (!error.isEmpty())
+    {
+        Ori::Dlg::error(tr("Invalid field rules\n\n%1").arg(error));
+        return;
+    }
+    QString key = _correlationKey->text().trimmed().toLower();
+    if (!key.isEmpty() && std::none_of(rules.begin(), rules.end(), [&key](const LogFieldRule& r){ return r.name == key; }))
+    {
+        Ori::Dlg::error(tr("Correlation key '%1' is not a field").arg(key));
+        return;
+    }
+    if (_ingest->isChecked() && !_ingestTcp->isChecked() && !_ingestUdp->isChecked())
+    {
+        Ori::Dlg::error(tr("Select TCP, UDP or both to receive records"));
+        return;
+    }
+    QDialog::accept();
+}
+
+QVector<LogFieldRule> OpenFilesDialog::selectedFieldRules() const
+{
+    QVector<LogFieldRule> rules;
+    LogFieldRule::parse(_fieldRules->toPlainText(), rules);
+    return rules;
+}
+
 void OpenFilesDialog::selectDirectory()
 {
     QString dir = QFileDialog::getExistingDirectory(this, tr("Select Logs Directory"), selectedDir());
@@ -272,14 +423,121 @@ void OpenFilesDialog::selectFilesInvert()
 {
 }
 
+/**
+    Shows files of the directory from the cache of a previous scan at once, if any,
+    and scans the directory again in background to add new files and drop removed ones.
+*/
 void OpenFilesDialog::populateFileList()
 {
-    QDir dir(selectedDir(), selectedFilter());
     _listFiles->clear();
-    auto files = dir.entryList();
-    sortFiles(files);
-    for (const QString& file: files)
-        _listFiles->addItem(file);
+    _scanned.clear();
+    _scannedPaths.clear();
+    _seenPaths.clear();
+
+    QVector<ScannedFile> cached;
+    if (FileScanner::cached(selectedDir(), _recursive->isChecked(), cached))
+        addScannedFiles(cached);
+    _seenPaths.clear();
+
+    _scanner->start(selectedDir(), _recursive->isChecked());
+    updateFilesInfo();
+}
+
+void OpenFilesDialog::scannedFilesFound()
+{
+    addScannedFiles(_scanner->takeFound());
+    updateFilesInfo();
+}
+
+void OpenFilesDialog::scanFinished()
+{
+    if (_seenPaths.size() != _scannedPaths.size())
+    {
+        // Some of cached files are not there anymore
+        QVector<ScannedFile> existing;
+        for (const ScannedFile& file : _scanned)
+            if (_seenPaths.contains(file.path))
+                existing.append(file);
+        _scanned = existing;
+        _scannedPaths = _seenPaths;
+        filterFileList();
+    }
+    updateFilesInfo();
+}
+
+void OpenFilesDialog::addScannedFiles(const QVector<ScannedFile>& files)
+{
+    auto filters = fileFilters();
+    for (const ScannedFile& file : files)
+    {
+        _seenPaths.insert(file.path);
+        if (_scannedPaths.contains(file.path)) continue;
+        _scannedPaths.insert(file.path);
+        _scanned.append(file);
+
+        if (FileScanner::matches(filters, file.path.section('/', -1)))
+            insertFileItem(file);
+    }
+}
+
+void OpenFilesDialog::insertFileItem(const ScannedFile& file)
+{
+    auto cs = _caseSensitiveFiles->isChecked()? Qt::CaseSensitive: Qt::CaseInsensitive;
+    int lo = 0, hi = _listFiles->count();
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        if (QString::compare(_listFiles->item(mid)->text(), file.path, cs) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    auto item = new QListWidgetItem(file.path);
+    item->setData(Qt::UserRole, file.size);
+    _listFiles->insertItem(lo, item);
+}
+
+/**
+    Applies the name filter to already scanned files, it does not touch the file system.
+*/
+void OpenFilesDialog::filterFileList()
+{
+    QSet<QString> selected;
+    for (QListWidgetItem* it : _listFiles->selectedItems())
+        selected.insert(it->text());
+
+    _listFiles->clear();
+    auto scanned = _scanned;
+    auto seen = _seenPaths;
+    _scanned.clear();
+    _scannedPaths.clear();
+    addScannedFiles(scanned);
+    _seenPaths = seen;
+
+    for (int i = 0; i < _listFiles->count(); i++)
+        if (selected.contains(_listFiles->item(i)->text()))
+            _listFiles->item(i)->setSelected(true);
+    updateFilesInfo();
+}
+
+QList<QRegExp> OpenFilesDialog::fileFilters() const
+{
+    auto cs = _caseSensitiveFiles->isChecked()? Qt::CaseSensitive: Qt::CaseInsensitive;
+    return FileScanner::nameFilters(selectedFilter(), cs);
+}
+
+void OpenFilesDialog::updateFilesInfo()
+{
+    qint64 size = 0;
+    auto selected = _listFiles->selectedItems();
+    for (QListWidgetItem* it : selected)
+        size += it->data(Qt::UserRole).toLongLong();
+
+    QString info = tr("Selected %1 of %2 files, %3 MB")
+            .arg(selected.size()).arg(_listFiles->count()).arg(size / 1048576.0, 0, 'f', 1);
+    if (_scanner->running())
+        info += tr(" (scanning...)");
+    _filesInfo->setText(info);
 }
 
 void OpenFilesDialog::filterChanged()
@@ -296,7 +554,7 @@ void OpenFilesDialog::timerEvent(QTimerEvent*)
     {
         killTimer(_updateFilterTimerId);
         _updateFilterTimerId = 0;
-        populateFileList();
+        filterFileList();
     }
     _lastTimerTick = now;
 }
@@ -340,13 +598,14 @@ void OpenFilesDialog::loadLogPreview()
     auto files = selectedFiles();
     if (files.empty()) return;
     auto file = files.first();
+    auto encoding = selectedEncoding();
 
     _logPreviewTitle->setText(file);
-    _logPreview->clear();
-    PreviewFileReader reader(_logPreview, 100, file, selectedEncoding());
-    QString res = reader.read();
-    if (!res.isEmpty())
-        _logPreview->setPlainText(tr("ERROR: %1").arg(res));
+    runInBackground(_previewRequest, _logPreview, [file, encoding]{
+        PreviewFileReader reader(PREVIEW_MAX_LINES, file, encoding);
+        QString res = reader.read();
+        return res.isEmpty() ? reader.text() : tr("ERROR: %1").arg(res);
+    });
 }
 
 void OpenFilesDialog::testParsing()
@@ -354,18 +613,63 @@ void OpenFilesDialog::testParsing()
     auto files = selectedFiles();
     if (files.empty()) return;
     auto file = files.first();
-
+    auto encoding = selectedEncoding();
     auto marker = selectedMarkerParams();
-    LogItems log;
-    LogFileReader reader(&marker, &log, file, selectedEncoding());
-    QString res = reader.read();
-    if (!res.isEmpty())
-        res = tr("ERROR: %1").arg(res);
-    else if (log.items().empty())
-        res = tr("No records where recognized");
-    else
-        res = log.str();
-    _parseResults->setPlainText(res);
+    QVector<LogFieldRule> rules;
+    QString rulesError = LogFieldRule::parse(_fieldRules->toPlainText(), rules);
+    if (!rulesError.isEmpty())
+    {
+        _parseResults->setPlainText(tr("ERROR: %1").arg(rulesError));
+        return;
+    }
+
+    runInBackground(_parseRequest, _parseResults, [file, encoding, marker, rules]() mutable {
+        LogItems log;
+        log.fields()->setRules(rules);
+        LogFileReader reader(&marker, &log, file, encoding);
+        reader.setMaxBytes(TEST_PARSING_MAX_BYTES);
+        reader.setMaxRecords(TEST_PARSING_MAX_RECORDS);
+        reader.setFieldRules(rules);
+        QString res = reader.read();
+        if (!res.isEmpty())
+            return tr("ERROR: %1").arg(res);
+        if (log.items().empty())
+            return tr("No records where recognized");
+        if (rules.isEmpty())
+            return log.str();
+
+        const LogFields* fields = log.fields();
+        QStringList messages;
+        for (const LogItem* item : log.items())
+        {
+            QStringList values;
+            for (int i = 0; i < fields->count(); i++)
+                if (fields->column(i).has(item->index))
+                    values << fields->column(i).name + '=' + fields->text(i, item->index);
+            messages << item->str();
+            if (!values.isEmpty())
+                messages << "  { " + values.join(", ") + " }";
+        }
+        return messages.join("\n");
+    });
+}
+
+/**
+    Runs the job in the thread pool and shows its result in the target editor.
+    Results of outdated jobs, superseded by a newer request, are dropped.
+*/
+void OpenFilesDialog::runInBackground(int& request, QPlainTextEdit* target, std::function<QString()> job)
+{
+    int id = ++request;
+    target->setPlainText(tr("Loading..."));
+
+    auto watcher = new QFutureWatcher<QString>(this);
+    connect(watcher, &QFutureWatcher<QString>::finished, this, [watcher, target, &request, id]{
+        if (id == request)
+            target->setPlainText(watcher->result());
+        watcher->deleteLater();
+    });
+    watcher->setFuture(QtConcurrent::run(job));
 }
 
 void OpenFilesDialog::sortFiles(QStringList& files) const
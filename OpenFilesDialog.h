@@ -4,14 +4,20 @@
 #include <QDialog>
 #include <QLabel>
 #include <QComboBox>
+#include <QSet>
 
+#include <functional>
+
+#include "FileScanner.h"
 #include "LogProcessor.h"
 
 QT_BEGIN_NAMESPACE
 class QCheckBox;
+class QLineEdit;
 class QListWidget;
 class QPlainTextEdit;
 class QSettings;
+class QSpinBox;
 class QTextEdit;
 QT_END_NAMESPACE
 
@@ -20,13 +26,15 @@ QT_END_NAMESPACE
 class PreviewFileReader : public FileReader
 {
 public:
-    PreviewFileReader(QPlainTextEdit* target, int maxLines, const QString& file, const QString& encoding);
+    PreviewFileReader(int maxLines, const QString& file, const QString& encoding);
 
     bool processLine(const QString& line) override;
 
+    QString text() const { return _lines.join('\n'); }
+
 private:
-    QPlainTextEdit* _target;
-    int _maxLines, _lineCount = 0;
+    QStringList _lines;
+    int _maxLines;
 };
 
 //--------------------------------------------------------------------------------------------------
@@ -77,6 +85,9 @@ public:
 
     LogParams result() const;
 
+public slots:
+    void accept() override;
+
 protected:
     void timerEvent(QTimerEvent*);
 
@@ -86,6 +97,10 @@ private slots:
     void selectFilesNone();
     void selectFilesInvert();
     void populateFileList();
+    void filterFileList();
+    void scannedFilesFound();
+    void scanFinished();
+    void updateFilesInfo();
     void filterChanged();
     void tabActivated(int index);
     void testParsing();
@@ -97,11 +112,22 @@ private:
     PersistentCombo *_leftMarker, *_rightMarker;
     QCheckBox *_leftMarkerRegexp, *_rightMarkerRegexp;
     QCheckBox *_caseSensitiveFiles;
+    QCheckBox *_recursive;
+    QLabel *_filesInfo;
+    FileScanner *_scanner;
+    QVector<ScannedFile> _scanned;
+    QSet<QString> _scannedPaths, _seenPaths;
+    QCheckBox *_outOfCore;
+    QSpinBox *_pageCacheSize;
+    QCheckBox *_ingest, *_ingestTcp, *_ingestUdp;
+    QSpinBox *_ingestPort, *_ingestMaxRecords, *_ingestMaxMB;
     PersistentCombo *_encoding;
-    QPlainTextEdit *_logPreview, *_parseResults;
+    QPlainTextEdit *_logPreview, *_parseResults, *_fieldRules;
+    QLineEdit *_correlationKey;
     QLabel* _logPreviewTitle;
     qint64 _lastTimerTick = 0;
     int _updateFilterTimerId = 0;
+    int _previewRequest = 0, _parseRequest = 0;
 
     void saveState();
     void restoreState();
@@ -114,9 +140,14 @@ private:
     bool selectedLeftMarkerRegexp() const;
     bool selectedRightMarkerRegexp() const;
     LogMarkersParams selectedMarkerParams() const;
+    QVector<LogFieldRule> selectedFieldRules() const;
 
     void loadLogPreview();
+    void runInBackground(int& request, QPlainTextEdit* target, std::function<QString()> job);
     void sortFiles(QStringList& files) const;
+    QList<QRegExp> fileFilters() const;
+    void addScannedFiles(const QVector<ScannedFile>& files);
+    void insertFileItem(const ScannedFile& file);
 };
 
 #endif // OPEN_FILES_DIALOG_H
@@ -0,0 +1,65 @@
+#include "PerfCounters.h"
+
+#include <QApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+//--------------------------------------------------------------------------------------------------
+
+void PerfCounters::reset()
+{
+    for (Counter& c : _counters)
+    {
+        c.nsecs = 0;
+        c.calls = 0;
+        c.bytes = 0;
+        c.records = 0;
+    }
+    _totalNsecs = 0;
+}
+
+QString PerfCounters::phaseName(Phase phase)
+{
+    switch (phase)
+    {
+    case Read: return qApp->tr("Read");
+    case Split: return qApp->tr("Split lines");
+    case Decode: return qApp->tr("Decode");
+    case Match: return qApp->tr("Match markers");
+    case Join: return qApp->tr("Join records");
+    case Extract: return qApp->tr("Extract fields");
+    case Filter: return qApp->tr("Filter");
+    case PhaseCount: break;
+    }
+    return QString();
+}
+
+QString PerfCounters::summary() const
+{
+    if (_totalNsecs <= 0) return QString();
+
+    double secs = _totalNsecs / 1e9;
+    double mbytes = bytes(Read) / 1048576.0;
+    return qApp->tr("Load: %1 s, %2 MB/s").arg(secs, 0, 'f', 2).arg(mbytes / secs, 0, 'f', 1);
+}
+
+QByteArray PerfCounters::toJson() const
+{
+    QJsonArray phases;
+    for (int i = 0; i < PhaseCount; i++)
+    {
+        auto phase = Phase(i);
+        QJsonObject obj;
+        obj["phase"] = phaseName(phase);
+        obj["nsecs"] = nsecs(phase);
+        obj["calls"] = calls(phase);
+        obj["bytes"] = bytes(phase);
+        obj["records"] = records(phase);
+        phases.append(obj);
+    }
+    QJsonObject root;
+    root["totalNsecs"] = _totalNsecs;
+    root["phases"] = phases;
+    return QJsonDocument(root).toJson();
+}
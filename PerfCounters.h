@@ -0,0 +1,102 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <QElapsedTimer>
+#include <QString>
+
+#include <atomic>
+
+//--------------------------------------------------------------------------------------------------
+
+class PerfCounters
+{
+public:
+    enum Phase { Read, Split, Decode, Match, Join, Extract, Filter, PhaseCount };
+
+    void addTime(Phase phase, qint64 nsecs, qint64 calls = 1)
+    {
+        _counters[phase].nsecs.fetch_add(nsecs, std::memory_order_relaxed);
+        _counters[phase].calls.fetch_add(calls, std::memory_order_relaxed);
+    }
+    void addBytes(Phase phase, qint64 bytes) { _counters[phase].bytes.fetch_add(bytes, std::memory_order_relaxed); }
+    void addRecords(Phase phase, qint64 records) { _counters[phase].records.fetch_add(records, std::memory_order_relaxed); }
+
+    qint64 nsecs(Phase phase) const { return _counters[phase].nsecs.load(std::memory_order_relaxed); }
+    qint64 calls(Phase phase) const { return _counters[phase].calls.load(std::memory_order_relaxed); }
+    qint64 bytes(Phase phase) const { return _counters[phase].bytes.load(std::memory_order_relaxed); }
+    qint64 records(Phase phase) const { return _counters[phase].records.load(std::memory_order_relaxed); }
+
+    void setTotalTime(qint64 nsecs) { _totalNsecs = nsecs; }
+    qint64 totalTime() const { return _totalNsecs; }
+
+    void reset();
+
+    static QString phaseName(Phase phase);
+
+    QString summary() const;
+    QByteArray toJson() const;
+
+private:
+    struct Counter
+    {
+        std::atomic<qint64> nsecs{0};
+        std::atomic<qint64> calls{0};
+        std::atomic<qint64> bytes{0};
+        std::atomic<qint64> records{0};
+    };
+    Counter _counters[PhaseCount];
+    qint64 _totalNsecs = 0;
+};
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+    Adds the lifetime of the object to the given phase counter.
+    Null counters are allowed and make the timer a no-op.
+*/
+class PerfTimer
+{
+public:
+    PerfTimer(PerfCounters* counters, PerfCounters::Phase phase) : _counters(counters), _phase(phase)
+    {
+        if (_counters) _timer.start();
+    }
+    ~PerfTimer()
+    {
+        if (_counters) _counters->addTime(_phase, _timer.nsecsElapsed());
+    }
+
+private:
+    PerfCounters* _counters;
+    PerfCounters::Phase _phase;
+    QElapsedTimer _timer;
+};
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+    Times one call of SampleEvery and counts it for all of them, so code running for
+    every line reads the clock rarely. The tick is kept by the caller between calls.
+*/
+class PerfSampledTimer
+{
+public:
+    enum { SampleEvery = 16 };
+
+    PerfSampledTimer(PerfCounters* counters, PerfCounters::Phase phase, quint32& tick)
+        : _counters(counters && tick++ % SampleEvery == 0 ? counters : nullptr), _phase(phase)
+    {
+        if (_counters) _timer.start();
+    }
+    ~PerfSampledTimer()
+    {
+        if (_counters) _counters->addTime(_phase, _timer.nsecsElapsed() * SampleEvery, SampleEvery);
+    }
+
+private:
+    PerfCounters* _counters;
+    PerfCounters::Phase _phase;
+    QElapsedTimer _timer;
+};
+
+#endif // PERF_COUNTERS_H
@@ -0,0 +1,69 @@
+#include "PerformancePanel.h"
+#include "PerfCounters.h"
+
+#include "helpers/OriLayouts.h"
+
+#include <QHeaderView>
+#include <QTableWidget>
+
+namespace {
+
+enum {
+    COL_PHASE,
+    COL_TIME,
+    COL_PERCENT,
+    COL_CALLS,
+    COL_BYTES,
+    COL_RECORDS,
+    COL_THROUGHPUT,
+
+    COL_COUNT
+};
+
+} // namespace
+
+PerformancePanel::PerformancePanel(QWidget *parent) : QWidget(parent)
+{
+    _table = new QTableWidget(PerfCounters::PhaseCount, COL_COUNT);
+    _table->setHorizontalHeaderLabels({ tr("Phase"), tr("Time, ms"), tr("%"), tr("Calls"),
+                                        tr("Bytes"), tr("Records"), tr("Throughput") });
+    _table->verticalHeader()->setVisible(false);
+    _table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    _table->setSelectionMode(QAbstractItemView::NoSelection);
+    _table->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+
+    Ori::Layouts::LayoutV({_table}).setMargin(3).useFor(this);
+}
+
+void PerformancePanel::populate(const PerfCounters* perf)
+{
+    double total = perf->totalTime();
+    for (int i = 0; i < PerfCounters::PhaseCount; i++)
+    {
+        auto phase = PerfCounters::Phase(i);
+        double secs = perf->nsecs(phase) / 1e9;
+        qint64 bytes = perf->bytes(phase);
+        qint64 records = perf->records(phase);
+
+        QString throughput;
+        if (secs > 0 && bytes > 0)
+            throughput = tr("%1 MB/s").arg(bytes / 1048576.0 / secs, 0, 'f', 1);
+        else if (secs > 0 && records > 0)
+            throughput = tr("%1 rec/s").arg(qRound64(records / secs));
+
+        auto setCell = [this, i](int col, const QString& text) {
+            auto it = _table->item(i, col);
+            if (!it) _table->setItem(i, col, it = new QTableWidgetItem);
+            it->setText(text);
+            if (col != COL_PHASE)
+                it->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+        };
+        setCell(COL_PHASE, PerfCounters::phaseName(phase));
+        setCell(COL_TIME, QString::number(secs * 1000, 'f', 1));
+        setCell(COL_PERCENT, total > 0 ? QString::number(perf->nsecs(phase) / total * 100, 'f', 1) : QString());
+        setCell(COL_CALLS, QString::number(perf->calls(phase)));
+        setCell(COL_BYTES, QString::number(bytes));
+        setCell(COL_RECORDS, QString::number(records));
+        setCell(COL_THROUGHPUT, throughput);
+    }
+}
@@ -0,0 +1,25 @@
+#ifndef PERFORMANCE_PANEL_H
+#define PERFORMANCE_PANEL_H
+
+#include <QWidget>
+
+QT_BEGIN_NAMESPACE
+class QTableWidget;
+QT_END_NAMESPACE
+
+class PerfCounters;
+
+class PerformancePanel : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit PerformancePanel(QWidget *parent = 0);
+
+    void populate(const PerfCounters* perf);
+
+private:
+    QTableWidget* _table;
+};
+
+#endif // PERFORMANCE_PANEL_H
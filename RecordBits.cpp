@@ -0,0 +1,153 @@
+#include "RecordBits.h"
+#include "Simd.h"
+
+namespace {
+
+enum Op { And, Or, AndNot };
+
+template <Op op> inline quint64 combineWord(quint64 a, quint64 b)
+{
+    return op == And ? a & b : (op == Or ? a | b : a & ~b);
+}
+
+template <Op op> void combine(quint64* a, const quint64* b, int n)
+{
+    int i = 0;
+#ifdef LOGOTRON_SSE2
+    for (; i + 2 <= n; i += 2)
+    {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        if (op == And) x = _mm_and_si128(x, y);
+        else if (op == Or) x = _mm_or_si128(x, y);
+        else x = _mm_andnot_si128(y, x);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(a + i), x);
+    }
+#endif
+    for (; i < n; i++)
+        a[i] = combineWord<op>(a[i], b[i]);
+}
+
+inline int popCount(quint64 w)
+{
+#if defined(__GNUC__)
+    return __builtin_popcountll(w);
+#else
+    w = w - ((w >> 1) & 0x5555555555555555ULL);
+    w = (w & 0x3333333333333333ULL) + ((w >> 2) & 0x3333333333333333ULL);
+    w = (w + (w >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return int((w * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+inline int trailingZeros(quint64 w)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(w);
+#else
+    int n = 0;
+    while (!(w & 1)) { w >>= 1; n++; }
+    return n;
+#endif
+}
+
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+
+RecordBits::RecordBits(int size, bool value) : _words((size + 63) / 64, value ? ~quint64(0) : 0), _size(size)
+{
+    if (value && (size & 63))
+        _words.last() = (quint64(1) << (size & 63)) - 1;
+}
+
+void RecordBits::resize(int size)
+{
+    int oldWords = _words.size();
+    _words.resize((size + 63) / 64);
+    for (int w = oldWords; w < _words.size(); w++)
+        _words[w] = 0;
+    _size = size;
+    if (size & 63)
+        _words.last() &= (quint64(1) << (size & 63)) - 1;
+}
+
+void RecordBits::removeFirst(int count)
+{
+    count = qMin(count, _size);
+    if (count <= 0) return;
+
+    const int shift = count >> 6, bits = count & 63;
+    const int n = _words.size();
+    for (int w = 0; w + shift < n; w++)
+    {
+        quint64 low = _words.at(w + shift) >> bits;
+        quint64 high = bits && w + shift + 1 < n ? _words.at(w + shift + 1) << (64 - bits) : 0;
+        _words[w] = low | high;
+    }
+    resize(_size - count);
+}
+
+int RecordBits::count() const
+{
+    int n = 0;
+    for (quint64 w : _words) n += popCount(w);
+    return n;
+}
+
+int RecordBits::count(int from, int to) const
+{
+    if (from >= to) return 0;
+    const int w0 = from >> 6, w1 = (to - 1) >> 6;
+    const quint64 head = ~quint64(0) << (from & 63);
+    const quint64 tail = ~quint64(0) >> (63 - ((to - 1) & 63));
+    if (w0 == w1) return popCount(_words.at(w0) & head & tail);
+
+    int n = popCount(_words.at(w0) & head);
+    for (int w = w0 + 1; w < w1; w++) n += popCount(_words.at(w));
+    return n + popCount(_words.at(w1) & tail);
+}
+
+bool RecordBits::none() const
+{
+    for (quint64 w : _words)
+        if (w) return false;
+    return true;
+}
+
+RecordBits& RecordBits::operator &= (const RecordBits& other)
+{
+    Q_ASSERT(_size == other._size);
+    combine<And>(_words.data(), other._words.constData(), _words.size());
+    return *this;
+}
+
+RecordBits& RecordBits::operator |= (const RecordBits& other)
+{
+    Q_ASSERT(_size == other._size);
+    combine<Or>(_words.data(), other._words.constData(), _words.size());
+    return *this;
+}
+
+RecordBits& RecordBits::andNot(const RecordBits& other)
+{
+    Q_ASSERT(_size == other._size);
+    combine<AndNot>(_words.data(), other._words.constData(), _words.size());
+    return *this;
+}
+
+QVector<int> RecordBits::indexes() const
+{
+    QVector<int> result;
+    result.reserve(count());
+    for (int i = 0; i < _words.size(); i++)
+    {
+        quint64 w = _words.at(i);
+        while (w)
+        {
+            result.append(i * 64 + trailingZeros(w));
+            w &= w - 1;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,59 @@
+#ifndef RECORD_BITS_H
+#define RECORD_BITS_H
+
+#include <QVector>
+
+/**
+    Fixed size set of record indexes stored as 64-bit words.
+    Set operations work on whole words, with SSE2 two words at a time.
+    Bits beyond the size are always zero.
+*/
+class RecordBits
+{
+public:
+    RecordBits() {}
+    explicit RecordBits(int size, bool value = false);
+
+    /// Changes the size, added bits are cleared.
+    void resize(int size);
+
+    /// Removes the first bits, the others move down by the count.
+    void removeFirst(int count);
+
+    int size() const { return _size; }
+    bool isEmpty() const { return _size == 0; }
+
+    bool testBit(int i) const { return (_words.at(i >> 6) >> (i & 63)) & 1; }
+    void setBit(int i) { _words[i >> 6] |= quint64(1) << (i & 63); }
+
+    int wordCount() const { return _words.size(); }
+    quint64 word(int w) const { return _words.at(w); }
+    quint64* words() { return _words.data(); }
+
+    /// Number of set bits.
+    int count() const;
+
+    /// Number of set bits in the range [from, to).
+    int count(int from, int to) const;
+    bool none() const;
+
+    RecordBits& operator &= (const RecordBits& other);
+    RecordBits& operator |= (const RecordBits& other);
+
+    /// Clears bits that are set in the other set.
+    RecordBits& andNot(const RecordBits& other);
+
+    RecordBits operator & (const RecordBits& other) const { RecordBits r(*this); return r &= other; }
+    static RecordBits andNot(const RecordBits& a, const RecordBits& b) { RecordBits r(a); return r.andNot(b); }
+
+    /// Indexes of set bits in ascending order.
+    QVector<int> indexes() const;
+
+    qint64 bytes() const { return qint64(_words.size()) * sizeof(quint64); }
+
+private:
+    QVector<quint64> _words;
+    int _size = 0;
+};
+
+#endif // RECORD_BITS_H
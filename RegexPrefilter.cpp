@@ -0,0 +1,306 @@
+#include "RegexPrefilter.h"
+#include "Simd.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace {
+
+int skipClass(const QString& p, int pos)
+{
+    pos++;
+    if (pos < p.size() && p.at(pos) == '^') pos++;
+    if (pos < p.size() && p.at(pos) == ']') pos++;
+    while (pos < p.size())
+    {
+        QChar c = p.at(pos);
+        if (c == '\\') { pos += 2; continue; }
+        if (c == ']') return pos + 1;
+        pos++;
+    }
+    return pos;
+}
+
+int skipGroup(const QString& p, int pos)
+{
+    int depth = 0;
+    while (pos < p.size())
+    {
+        QChar c = p.at(pos);
+        if (c == '\\') { pos += 2; continue; }
+        if (c == '[') { pos = skipClass(p, pos); continue; }
+        if (c == '(') depth++;
+        else if (c == ')' && --depth == 0) return pos + 1;
+        pos++;
+    }
+    return pos;
+}
+
+/**
+    Skips a quantifier at the position if there is one,
+    optional is set when it allows zero repetitions.
+*/
+int skipQuantifier(const QString& p, int pos, bool& optional)
+{
+    optional = false;
+    if (pos >= p.size()) return pos;
+    QChar c = p.at(pos);
+    if (c == '*' || c == '?')
+        optional = true;
+    else if (c == '{')
+    {
+        int close = p.indexOf('}', pos);
+        if (close < 0) return pos;
+        int comma = p.indexOf(',', pos);
+        int end = comma >= 0 && comma < close ? comma : close;
+        bool ok;
+        int min = p.mid(pos + 1, end - pos - 1).toInt(&ok);
+        optional = !ok || min == 0;
+        pos = close;
+    }
+    else if (c != '+')
+        return pos;
+    pos++;
+    if (pos < p.size() && (p.at(pos) == '?' || p.at(pos) == '+')) pos++;
+    return pos;
+}
+
+bool isAscii(QChar c) { return c.unicode() < 128; }
+
+bool isAscii(const QString& s)
+{
+    for (QChar c : s)
+        if (!isAscii(c)) return false;
+    return true;
+}
+
+/**
+    Characters equal to the ASCII character ignoring case, including
+    non-ASCII ones which lower or fold to it like the Kelvin sign to 'k'.
+*/
+void caseVariants(QChar c, ushort* variants)
+{
+    QChar lower = c.toLower();
+    variants[0] = lower.unicode();
+    variants[1] = c.toUpper().unicode();
+    switch (lower.unicode())
+    {
+    case 'k': variants[2] = 0x212A; break;
+    case 's': variants[2] = 0x017F; break;
+    case 'i': variants[2] = 0x0130; break;
+    default: variants[2] = lower.unicode();
+    }
+}
+
+inline bool isVariant(ushort c, const ushort* variants)
+{
+    return c == variants[0] || c == variants[1] || c == variants[2];
+}
+
+inline int trailingZeros(uint w)
+{
+#if defined(__GNUC__)
+    return __builtin_ctz(w);
+#else
+    int n = 0;
+    while (!(w & 1)) { w >>= 1; n++; }
+    return n;
+#endif
+}
+
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+
+RegexPrefilter::RegexPrefilter(const QRegExp& regex)
+{
+    if (!regex.isValid()) return;
+
+    _caseSensitive = regex.caseSensitivity() == Qt::CaseSensitive;
+    switch (regex.patternSyntax())
+    {
+    case QRegExp::RegExp:
+    case QRegExp::RegExp2:
+        _literal = requiredLiteral(regex.pattern(), !_caseSensitive, &_prefix);
+        break;
+    case QRegExp::FixedString:
+        if (_caseSensitive || isAscii(regex.pattern()))
+        {
+            _literal = regex.pattern();
+            _prefix = true;
+        }
+        break;
+    default:
+        break;
+    }
+    if (_literal.isEmpty()) return;
+
+    if (_caseSensitive)
+    {
+        std::fill(_first, _first + 3, _literal.at(0).unicode());
+        std::fill(_last, _last + 3, _literal.at(_literal.size() - 1).unicode());
+    }
+    else
+    {
+        _folded = _literal.toLower();
+        caseVariants(_literal.at(0), _first);
+        caseVariants(_literal.at(_literal.size() - 1), _last);
+    }
+}
+
+/**
+    Scans the pattern for runs of plain characters. A run is broken by anything
+    else and a character under an optional quantifier is dropped from it.
+    Groups are skipped as a whole, so literals inside them are not used.
+*/
+QString RegexPrefilter::requiredLiteral(const QString& p, bool asciiOnly, bool* isPrefix)
+{
+    // With alternatives at the top level there is no text every match has
+    for (int pos = 0; pos < p.size(); )
+    {
+        QChar c = p.at(pos);
+        if (c == '\\') pos += 2;
+        else if (c == '[') pos = skipClass(p, pos);
+        else if (c == '(') pos = skipGroup(p, pos);
+        else if (c == '|') return QString();
+        else pos++;
+    }
+
+    QString best, run;
+    bool bestIsPrefix = false, runIsPrefix = true;
+    auto endRun = [&]()
+    {
+        if (run.size() > best.size())
+        {
+            best = run;
+            bestIsPrefix = runIsPrefix;
+        }
+        run.clear();
+        runIsPrefix = false;
+    };
+
+    int pos = 0;
+    if (p.startsWith('^')) pos++;
+    while (pos < p.size())
+    {
+        QChar c = p.at(pos);
+        QChar literal;
+        bool isLiteral = false;
+        int next = pos + 1;
+        if (c == '\\')
+        {
+            if (next >= p.size()) break;
+            QChar e = p.at(next++);
+            switch (e.unicode())
+            {
+            case 'n': literal = '\n'; isLiteral = true; break;
+            case 'r': literal = '\r'; isLiteral = true; break;
+            case 't': literal = '\t'; isLiteral = true; break;
+            case 'f': literal = '\f'; isLiteral = true; break;
+            case 'x':
+                while (next < p.size() && next < pos + 6 && isxdigit(p.at(next).toLatin1())) next++;
+                break;
+            case '0':
+                while (next < p.size() && next < pos + 5 && p.at(next) >= '0' && p.at(next) <= '7') next++;
+                break;
+            default:
+                if (!e.isLetterOrNumber())
+                {
+                    literal = e;
+                    isLiteral = true;
+                }
+            }
+        }
+        else if (c == '[')
+            next = skipClass(p, pos);
+        else if (c == '(')
+            next = skipGroup(p, pos);
+        else if (c != '.' && c != '^' && c != '$' && c != '*' && c != '+' && c != '?' && c != '{')
+        {
+            literal = c;
+            isLiteral = true;
+        }
+        if (isLiteral && asciiOnly && !isAscii(literal))
+            isLiteral = false;
+
+        bool optional;
+        int after = skipQuantifier(p, next, optional);
+        if (!isLiteral || optional)
+            endRun();
+        else
+        {
+            run += literal;
+            if (after != next) endRun();
+        }
+        pos = after;
+    }
+    endRun();
+
+    if (isPrefix) *isPrefix = bestIsPrefix;
+    return best;
+}
+
+bool RegexPrefilter::matchesAt(const ushort* s) const
+{
+    const int n = _literal.size();
+    if (_caseSensitive)
+        return std::memcmp(s, _literal.utf16(), n * sizeof(ushort)) == 0;
+
+    const QChar* folded = _folded.constData();
+    for (int i = 0; i < n; i++)
+    {
+        QChar c(s[i]);
+        if (c.toLower() != folded[i] && c.toCaseFolded() != folded[i])
+            return false;
+    }
+    return true;
+}
+
+int RegexPrefilter::indexIn(const QString& str, int offset) const
+{
+    const int n = _literal.size();
+    if (n == 0) return offset;
+
+    const ushort* s = str.utf16();
+    const int last = str.size() - n;
+    int i = qMax(offset, 0);
+#ifdef LOGOTRON_SSE2
+    const __m128i first0 = _mm_set1_epi16(short(_first[0]));
+    const __m128i first1 = _mm_set1_epi16(short(_first[1]));
+    const __m128i first2 = _mm_set1_epi16(short(_first[2]));
+    const __m128i last0 = _mm_set1_epi16(short(_last[0]));
+    const __m128i last1 = _mm_set1_epi16(short(_last[1]));
+    const __m128i last2 = _mm_set1_epi16(short(_last[2]));
+    for (; i + 8 <= last + 1; i += 8)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i + n - 1));
+        __m128i fa = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi16(a, first0), _mm_cmpeq_epi16(a, first1)),
+                                  _mm_cmpeq_epi16(a, first2));
+        __m128i lb = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi16(b, last0), _mm_cmpeq_epi16(b, last1)),
+                                  _mm_cmpeq_epi16(b, last2));
+        // Two mask bits per character where both the first and the last characters fit
+        uint mask = uint(_mm_movemask_epi8(_mm_and_si128(fa, lb)));
+        while (mask)
+        {
+            int bit = trailingZeros(mask);
+            if (matchesAt(s + i + bit / 2))
+                return i + bit / 2;
+            mask &= ~(3u << bit);
+        }
+    }
+#endif
+    for (; i <= last; i++)
+        if (isVariant(s[i], _first) && isVariant(s[i + n - 1], _last) && matchesAt(s + i))
+            return i;
+    return -1;
+}
+
+int RegexPrefilter::startOf(const QString& s, int offset) const
+{
+    if (_literal.isEmpty()) return offset;
+    int pos = indexIn(s, offset);
+    if (pos < 0) return -1;
+    return _prefix ? pos : offset;
+}
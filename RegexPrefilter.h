@@ -0,0 +1,47 @@
+#ifndef REGEX_PREFILTER_H
+#define REGEX_PREFILTER_H
+
+#include <QRegExp>
+#include <QString>
+
+/**
+    Literal text every match of a regular expression contains, found by a scan of the
+    pattern: the longest run of plain characters outside of groups, classes and alternations
+    that no quantifier makes optional. Lines without the literal are rejected by a search
+    comparing the first and the last characters of the literal at 8 positions at a time
+    with SSE2, the regex engine only runs on lines having it.
+
+    Patterns having top-level alternatives or no required literal get an empty prefilter
+    that passes everything. For case-insensitive patterns only ASCII literals are used.
+*/
+class RegexPrefilter
+{
+public:
+    RegexPrefilter() {}
+    explicit RegexPrefilter(const QRegExp& regex);
+
+    bool isEmpty() const { return _literal.isEmpty(); }
+    const QString& literal() const { return _literal; }
+
+    /// Position of the literal in the text starting from the offset or -1 if it is not there.
+    int indexIn(const QString& s, int offset = 0) const;
+
+    /// Offset to start the regex search from, -1 if the text cannot match.
+    /// It is the position of the literal when every match starts with it.
+    int startOf(const QString& s, int offset = 0) const;
+
+    /// Required literal of a pattern of QRegExp::RegExp or RegExp2 syntax,
+    /// isPrefix is set when every match starts with it.
+    static QString requiredLiteral(const QString& pattern, bool asciiOnly, bool* isPrefix = nullptr);
+
+private:
+    QString _literal;
+    QString _folded; ///< lower case literal for case-insensitive comparison
+    bool _caseSensitive = true;
+    bool _prefix = false;
+    ushort _first[3] = {}, _last[3] = {}; ///< case variants of the first and last characters
+
+    bool matchesAt(const ushort* s) const;
+};
+
+#endif // REGEX_PREFILTER_H
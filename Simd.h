@@ -0,0 +1,11 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+// SSE2 is a part of the x86-64 baseline, so it is used without runtime checks there.
+// Other platforms get scalar code paths.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LOGOTRON_SSE2
+#include <emmintrin.h>
+#endif
+
+#endif // SIMD_H
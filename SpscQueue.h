@@ -0,0 +1,71 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <QThread>
+
+#include <atomic>
+
+/**
+    Bounded lock-free queue between one producer thread and one consumer thread.
+    Waiting for room or for an item spins briefly, then yields and then sleeps,
+    so a stage waiting on a slower one does not keep a core busy.
+*/
+template <typename T, int Capacity>
+class SpscQueue
+{
+public:
+    bool tryPush(const T& value)
+    {
+        const quint64 tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _head.load(std::memory_order_acquire) == Capacity) return false;
+        _items[tail % Capacity] = value;
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& value)
+    {
+        const quint64 head = _head.load(std::memory_order_relaxed);
+        if (_tail.load(std::memory_order_acquire) == head) return false;
+        value = _items[head % Capacity];
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Waits for room, returns false if the pipeline is cancelled meanwhile.
+    bool push(const T& value, const std::atomic<bool>& cancelled)
+    {
+        for (int attempt = 0; !tryPush(value); attempt++)
+        {
+            if (cancelled.load(std::memory_order_relaxed)) return false;
+            backoff(attempt);
+        }
+        return true;
+    }
+
+    /// Waits for an item, returns false if the pipeline is cancelled meanwhile.
+    bool pop(T& value, const std::atomic<bool>& cancelled)
+    {
+        for (int attempt = 0; !tryPop(value); attempt++)
+        {
+            if (cancelled.load(std::memory_order_relaxed)) return false;
+            backoff(attempt);
+        }
+        return true;
+    }
+
+private:
+    T _items[Capacity];
+    // Indexes only grow, they are on different cache lines not to bounce between cores
+    alignas(64) std::atomic<quint64> _head{0};
+    alignas(64) std::atomic<quint64> _tail{0};
+
+    static void backoff(int attempt)
+    {
+        if (attempt < 64) return;
+        if (attempt < 128) QThread::yieldCurrentThread();
+        else QThread::usleep(50);
+    }
+};
+
+#endif // SPSC_QUEUE_H
@@ -0,0 +1,73 @@
+#include "StringPool.h"
+
+StringPool::~StringPool()
+{
+    for (const QAtomicPointer<QString>& chunk : _chunks)
+        delete[] chunk.loadAcquire();
+}
+
+int StringPool::intern(QString& s)
+{
+    Shard& shard = _shards[qHash(s) % ShardCount];
+    QMutexLocker shardLocker(&shard.lock);
+
+    auto it = shard.ids.constFind(s);
+    if (it != shard.ids.constEnd())
+    {
+        s = it.key();
+        return it.value();
+    }
+
+    int id;
+    {
+        QMutexLocker arenaLocker(&_arenaLock);
+        id = _count;
+        int chunk = id >> ChunkBits;
+        Q_ASSERT(chunk < MaxChunks);
+        QString* strings = _chunks[chunk].loadAcquire();
+        if (!strings)
+        {
+            strings = new QString[ChunkSize];
+            _chunks[chunk].storeRelease(strings);
+        }
+        strings[id & (ChunkSize-1)] = s;
+        _count++;
+        _bytes += bytes(s);
+    }
+    shard.ids.insert(s, id);
+    return id;
+}
+
+int StringPool::find(const QString& s) const
+{
+    const Shard& shard = _shards[qHash(s) % ShardCount];
+    QMutexLocker locker(&shard.lock);
+    return shard.ids.value(s, -1);
+}
+
+int StringPool::count() const
+{
+    QMutexLocker locker(&_arenaLock);
+    return _count;
+}
+
+qint64 StringPool::bytes(const QString& s)
+{
+    if (s.capacity() == 0) return 0; // shared null or empty data
+    return sizeof(QString::Data) + (s.capacity() + 1) * sizeof(QChar);
+}
+
+qint64 StringPool::memoryUsage() const
+{
+    // Hash node: key, value, hash and next pointer plus allocator overhead
+    const qint64 hashNodeSize = sizeof(QString) + sizeof(int) + sizeof(uint) + sizeof(void*) + 16;
+
+    qint64 res;
+    {
+        QMutexLocker locker(&_arenaLock);
+        res = _count * hashNodeSize + _bytes;
+    }
+    for (const QAtomicPointer<QString>& chunk : _chunks)
+        if (chunk.loadAcquire()) res += ChunkSize * qint64(sizeof(QString));
+    return res;
+}
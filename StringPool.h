@@ -0,0 +1,63 @@
+#ifndef STRING_POOL_H
+#define STRING_POOL_H
+
+#include <QAtomicPointer>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+/**
+    Thread-safe interning pool. Each distinct string is stored once and gets an integer id,
+    so records can share string data and compare strings by their ids.
+*/
+class StringPool
+{
+public:
+    StringPool() {}
+    ~StringPool();
+
+    /// Replaces the string with the pooled copy sharing its data and returns its id.
+    int intern(QString& s);
+
+    /// Returns the id of the string or -1 if it is not in the pool.
+    int find(const QString& s) const;
+
+    /// Can be called while other threads intern strings, for ids returned by intern() or find().
+    const QString& string(int id) const;
+    int count() const;
+
+    qint64 memoryUsage() const;
+
+    /// Size of the string payload in memory.
+    static qint64 bytes(const QString& s);
+
+private:
+    enum { ShardCount = 16 };
+    enum { ChunkBits = 16, ChunkSize = 1 << ChunkBits, MaxChunks = 1 << 12 };
+
+    struct Shard
+    {
+        mutable QMutex lock;
+        QHash<QString, int> ids;
+    };
+    Shard _shards[ShardCount];
+
+    // Strings are stored in fixed size chunks that are never moved, so a string can be read
+    // by id while other threads add new strings. A chunk is published with release semantics
+    // after it is allocated, readers load its pointer without taking the lock.
+    QAtomicPointer<QString> _chunks[MaxChunks];
+    mutable QMutex _arenaLock;
+    int _count = 0;
+    qint64 _bytes = 0; ///< payloads of pooled strings, summed when they are added
+
+    Q_DISABLE_COPY(StringPool)
+};
+
+inline const QString& StringPool::string(int id) const
+{
+    const QString* strings = _chunks[id >> ChunkBits].loadAcquire();
+    Q_ASSERT(strings);
+    return strings[id & (ChunkSize-1)];
+}
+
+#endif // STRING_POOL_H
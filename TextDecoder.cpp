@@ -0,0 +1,291 @@
+#include "TextDecoder.h"
+#include "Simd.h"
+
+#include <QSysInfo>
+#include <QTextCodec>
+
+namespace {
+
+const ushort ReplacementChar = 0xFFFD;
+
+/**
+    Widens the leading run of ASCII bytes into UTF-16 16 bytes at a time.
+    Returns the number of converted bytes, the rest is left for a scalar loop.
+*/
+inline int widenAscii(const uchar* src, int len, ushort* dst)
+{
+    int i = 0;
+#ifdef LOGOTRON_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= len; i += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        if (_mm_movemask_epi8(v) != 0) break;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi8(v, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 8), _mm_unpackhi_epi8(v, zero));
+    }
+#else
+    Q_UNUSED(src)
+    Q_UNUSED(len)
+    Q_UNUSED(dst)
+#endif
+    return i;
+}
+
+/**
+    Decodes UTF-8 into UTF-16, the output buffer must have room for len characters.
+    Invalid sequences are replaced with U+FFFD. Returns the number of consumed bytes,
+    it is less than len when the input ends in the middle of a sequence.
+*/
+int decodeUtf8(const uchar* src, int len, ushort* dst, int& written)
+{
+    int i = 0, o = 0;
+    while (i < len)
+    {
+        int n = widenAscii(src + i, len - i, dst + o);
+        i += n;
+        o += n;
+
+        while (i < len)
+        {
+            uchar c = src[i];
+            if (c < 0x80)
+            {
+                dst[o++] = c;
+                i++;
+                continue;
+            }
+
+            uint cp;
+            int need;
+            uint min;
+            if ((c & 0xE0) == 0xC0) { cp = c & 0x1F; need = 1; min = 0x80; }
+            else if ((c & 0xF0) == 0xE0) { cp = c & 0x0F; need = 2; min = 0x800; }
+            else if ((c & 0xF8) == 0xF0) { cp = c & 0x07; need = 3; min = 0x10000; }
+            else
+            {
+                dst[o++] = ReplacementChar;
+                i++;
+                continue;
+            }
+
+            int avail = qMin(need, len - i - 1);
+            bool valid = true;
+            for (int k = 1; k <= avail; k++)
+            {
+                uchar b = src[i+k];
+                if ((b & 0xC0) != 0x80)
+                {
+                    valid = false;
+                    break;
+                }
+                cp = (cp << 6) | (b & 0x3F);
+            }
+            if (valid && avail < need)
+            {
+                // Incomplete sequence, it will be completed by the next block
+                written = o;
+                return i;
+            }
+            if (!valid)
+            {
+                dst[o++] = ReplacementChar;
+                i++;
+                continue;
+            }
+
+            i += need + 1;
+            if (cp < min || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
+                dst[o++] = ReplacementChar;
+            else if (cp >= 0x10000)
+            {
+                dst[o++] = QChar::highSurrogate(cp);
+                dst[o++] = QChar::lowSurrogate(cp);
+            }
+            else
+                dst[o++] = ushort(cp);
+
+            // Get back to the fast path when ASCII text continues
+            if (i < len && src[i] < 0x80) break;
+        }
+    }
+    written = o;
+    return i;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+class Utf8Decoder : public TextDecoder
+{
+public:
+    void decode(const char* data, int size, QString& out) override
+    {
+        if (_atStart)
+        {
+            _atStart = false;
+            if (size >= 3 && uchar(data[0]) == 0xEF && uchar(data[1]) == 0xBB && uchar(data[2]) == 0xBF)
+            {
+                data += 3;
+                size -= 3;
+            }
+        }
+
+        QByteArray joined;
+        if (!_pending.isEmpty())
+        {
+            joined = _pending + QByteArray::fromRawData(data, size);
+            data = joined.constData();
+            size = joined.size();
+            _pending.clear();
+        }
+
+        int start = out.size();
+        out.resize(start + size);
+        int written = 0;
+        int consumed = decodeUtf8(reinterpret_cast<const uchar*>(data), size,
+                                  reinterpret_cast<ushort*>(out.data() + start), written);
+        out.resize(start + written);
+
+        if (consumed < size)
+            _pending = QByteArray(data + consumed, size - consumed);
+    }
+
+    void finish(QString& out) override
+    {
+        if (!_pending.isEmpty())
+        {
+            out.append(QChar(ReplacementChar));
+            _pending.clear();
+        }
+    }
+
+    TextDecoder* clone() const override { return new Utf8Decoder; }
+
+private:
+    QByteArray _pending;
+    bool _atStart = true;
+};
+
+//--------------------------------------------------------------------------------------------------
+
+class SingleByteDecoder : public TextDecoder
+{
+public:
+    /// Builds the lookup table by decoding every byte separately.
+    /// Returns false if the codec is not a single-byte one.
+    bool init(QTextCodec* codec)
+    {
+        _asciiIdentity = true;
+        for (int b = 0; b < 256; b++)
+        {
+            char c = char(b);
+            QString s = codec->toUnicode(&c, 1);
+            if (s.size() != 1) return false;
+            _table[b] = s.at(0).unicode();
+            if (b < 0x80 && _table[b] != b)
+                _asciiIdentity = false;
+        }
+        return true;
+    }
+
+    void decode(const char* data, int size, QString& out) override
+    {
+        int start = out.size();
+        out.resize(start + size);
+        auto src = reinterpret_cast<const uchar*>(data);
+        auto dst = reinterpret_cast<ushort*>(out.data() + start);
+
+        if (!_asciiIdentity)
+        {
+            for (int i = 0; i < size; i++)
+                dst[i] = _table[src[i]];
+            return;
+        }
+
+        int i = 0;
+        while (i < size)
+        {
+            i += widenAscii(src + i, size - i, dst + i);
+            int end = qMin(size, i + 16);
+            for (; i < end; i++)
+                dst[i] = _table[src[i]];
+        }
+    }
+
+    // The table is the only state, it does not change while decoding
+    TextDecoder* clone() const override { return new SingleByteDecoder(*this); }
+
+private:
+    ushort _table[256];
+    bool _asciiIdentity;
+};
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+    Generic decoder for encodings without a dedicated fast path (UTF-16, UTF-32, multi-byte CJK).
+*/
+class CodecDecoder : public TextDecoder
+{
+public:
+    CodecDecoder(QTextCodec* codec) : _codec(codec), _decoder(codec->makeDecoder()), _mib(codec->mibEnum()) {}
+    ~CodecDecoder() { delete _decoder; }
+
+    bool asciiCompatible() const override
+    {
+        // UTF-16 and UTF-32 families
+        return !(_mib >= 1013 && _mib <= 1019);
+    }
+
+    LineScanner::Units lineUnits() const override
+    {
+        switch (_mib)
+        {
+        case 1013: return LineScanner::Utf16BE;
+        case 1014: return LineScanner::Utf16LE;
+        case 1015:
+            // Byte order marks select one of the codecs above, without them Qt takes the host order
+            return QSysInfo::ByteOrder == QSysInfo::BigEndian ? LineScanner::Utf16BE : LineScanner::Utf16LE;
+        }
+        return asciiCompatible() ? LineScanner::Bytes : LineScanner::Unsupported;
+    }
+
+    void decode(const char* data, int size, QString& out) override
+    {
+        out.append(_decoder->toUnicode(data, size));
+    }
+
+    TextDecoder* clone() const override { return new CodecDecoder(_codec); }
+
+private:
+    QTextCodec* _codec;
+    QTextDecoder* _decoder;
+    int _mib;
+};
+
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+
+QTextCodec* TextDecoder::codecFor(const QString& encoding, const QByteArray& head)
+{
+    auto codec = QTextCodec::codecForName(encoding.toLatin1());
+    if (!codec) codec = QTextCodec::codecForLocale();
+    return QTextCodec::codecForUtfText(head, codec);
+}
+
+TextDecoder* TextDecoder::create(const QString& encoding, const QByteArray& head)
+{
+    auto codec = codecFor(encoding, head);
+
+    const int mibUtf8 = 106;
+    if (codec->mibEnum() == mibUtf8)
+        return new Utf8Decoder;
+
+    auto singleByte = new SingleByteDecoder;
+    if (singleByte->init(codec))
+        return singleByte;
+    delete singleByte;
+
+    return new CodecDecoder(codec);
+}
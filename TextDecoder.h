@@ -0,0 +1,45 @@
+#ifndef TEXT_DECODER_H
+#define TEXT_DECODER_H
+
+#include <QString>
+
+#include "LineScanner.h"
+
+QT_BEGIN_NAMESPACE
+class QTextCodec;
+QT_END_NAMESPACE
+
+/**
+    Converts raw file bytes into text block by block.
+    Byte sequences split between blocks are carried over to the next call.
+*/
+class TextDecoder
+{
+public:
+    virtual ~TextDecoder() {}
+
+    /// Appends decoded text of the whole buffer to the string.
+    virtual void decode(const char* data, int size, QString& out) = 0;
+
+    /// Flushes an incomplete byte sequence left at the end of input.
+    virtual void finish(QString&) {}
+
+    /// New decoder of the same encoding in the initial state, it is cheaper than create().
+    virtual TextDecoder* clone() const = 0;
+
+    /// Line feeds are encoded as single 0x0A bytes never met inside other characters,
+    /// so raw bytes can be split into lines before decoding.
+    virtual bool asciiCompatible() const { return true; }
+
+    /// How line feeds look in raw bytes, they are found there before decoding.
+    virtual LineScanner::Units lineUnits() const { return LineScanner::Bytes; }
+
+    /// Creates the fastest decoder available for the encoding.
+    /// The head of the file is used to detect a byte order mark which overrides the encoding.
+    static TextDecoder* create(const QString& encoding, const QByteArray& head);
+
+    /// Codec for the encoding, overridden by a byte order mark found in the head of the file.
+    static QTextCodec* codecFor(const QString& encoding, const QByteArray& head);
+};
+
+#endif // TEXT_DECODER_H
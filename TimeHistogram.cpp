@@ -0,0 +1,322 @@
+#include "TimeHistogram.h"
+#include "RecordBits.h"
+
+#include <QtMath>
+
+namespace {
+
+// Each resolution divides the next one, so buckets of all levels are aligned
+const qint64 Resolutions[TimeHistogram::LevelCount] = {
+    1000, 10 * 1000, 60 * 1000, 600 * 1000,
+    3600 * 1000, 6 * 3600 * 1000, 24 * 3600 * 1000, 7 * 24 * 3600 * qint64(1000) };
+
+// Limits memory when the records span years; then the finest levels are not computed
+const qint64 MaxBucketsPerLevel = 4 * 1024 * 1024;
+
+qint64 floorDiv(qint64 a, qint64 b)
+{
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+
+int TimeHistogram::Bucket::total() const
+{
+    int sum = 0;
+    for (int c : counts) sum += c;
+    return sum;
+}
+
+qint64 TimeHistogram::resolution(int level)
+{
+    return Resolutions[level];
+}
+
+void TimeHistogram::clear()
+{
+    _start = 0;
+    _finest = 0;
+    _untimed = 0;
+    _firstTime = 0;
+    _lastTime = 0;
+    for (auto& level : _levels) level.clear();
+    _runs.clear();
+    _recordCount = 0;
+}
+
+void TimeHistogram::append(const LogItem* item)
+{
+    Q_ASSERT(item->index == _recordCount);
+    const qint64 time = item->time;
+    const qint64 second = time == LogItem::NoTime ? LogItem::NoTime : floorDiv(time, 1000) * 1000;
+    if (_runs.isEmpty() || _runs.last().second != second || _runs.last().type != item->type)
+        _runs.append({ second, _recordCount, item->type });
+    _recordCount++;
+
+    if (time == LogItem::NoTime)
+    {
+        _untimed++;
+        return;
+    }
+    if (isEmpty())
+        _firstTime = _lastTime = time;
+    else
+    {
+        _firstTime = qMin(_firstTime, time);
+        _lastTime = qMax(_lastTime, time);
+    }
+    cover(time);
+    addCount(item->type, time, 1);
+}
+
+void TimeHistogram::removeFirst(int count)
+{
+    count = qMin(count, _recordCount);
+    if (count <= 0) return;
+
+    int r = 0;
+    int end = 0;
+    for (; r < _runs.size() && _runs.at(r).first < count; r++)
+    {
+        const Run& run = _runs.at(r);
+        end = r+1 < _runs.size() ? _runs.at(r+1).first : _recordCount;
+        int n = qMin(end, count) - run.first;
+        if (run.second == LogItem::NoTime)
+            _untimed -= n;
+        else
+            addCount(run.type, run.second, -n);
+    }
+    // The last run touched can go on after the removed records
+    if (end > count)
+    {
+        r--;
+        _runs[r].first = count;
+    }
+    _runs.remove(0, r);
+    for (Run& run : _runs)
+        run.first -= count;
+    _recordCount -= count;
+    trimStart();
+}
+
+/**
+    Drops empty buckets before the first counted record and moves the first time to the
+    first non-empty bucket, so removed records leave neither a gap nor buckets behind.
+    The start stays aligned to the coarsest resolution as cover() keeps it.
+*/
+void TimeHistogram::trimStart()
+{
+    if (isEmpty()) return;
+
+    const QVector<Bucket>& coarsest = _levels[LevelCount-1];
+    int empty = 0;
+    while (empty < coarsest.size() && coarsest.at(empty).total() == 0)
+        empty++;
+    if (empty == coarsest.size())
+    {
+        // No timed records are left, the next one starts the histogram again
+        for (auto& level : _levels) level.clear();
+        _start = 0;
+        _finest = 0;
+        _firstTime = 0;
+        _lastTime = 0;
+        return;
+    }
+    if (empty > 0)
+    {
+        for (int level = _finest; level < LevelCount; level++)
+            _levels[level].remove(0, int(empty * (Resolutions[LevelCount-1] / Resolutions[level])));
+        _start += empty * Resolutions[LevelCount-1];
+    }
+
+    const QVector<Bucket>& finest = _levels[_finest];
+    int first = 0;
+    while (finest.at(first).total() == 0)
+        first++;
+    _firstTime = qMax(_firstTime, _start + first * Resolutions[_finest]);
+}
+
+/**
+    Extends levels with empty buckets to include the time. When the time span gets too long
+    for the finest levels they are dropped, coarser levels are counted on their own.
+*/
+void TimeHistogram::cover(qint64 time)
+{
+    const qint64 coarsest = Resolutions[LevelCount-1];
+    qint64 start = floorDiv(time, coarsest) * coarsest;
+    qint64 end = start + coarsest;
+    if (isEmpty())
+        _start = start;
+    else
+    {
+        if (time >= _start && time < endTime()) return;
+        start = qMin(start, _start);
+        end = qMax(end, endTime());
+    }
+
+    while (_finest < LevelCount-1 && (end - start) / Resolutions[_finest] > MaxBucketsPerLevel)
+    {
+        _levels[_finest].clear();
+        _levels[_finest].squeeze();
+        _finest++;
+    }
+    for (int level = _finest; level < LevelCount; level++)
+    {
+        QVector<Bucket>& buckets = _levels[level];
+        int before = int((_start - start) / Resolutions[level]);
+        if (before > 0)
+            buckets.insert(0, before, Bucket());
+        buckets.resize(int((end - start) / Resolutions[level]));
+    }
+    _start = start;
+}
+
+void TimeHistogram::addCount(LogItem::Type type, qint64 time, int delta)
+{
+    for (int level = _finest; level < LevelCount; level++)
+        _levels[level][int((time - _start) / Resolutions[level])].counts[type] += delta;
+}
+
+/**
+    Fills coarser levels from the finest one, they must be empty.
+*/
+void TimeHistogram::sumLevels()
+{
+    for (int level = _finest+1; level < LevelCount; level++)
+    {
+        const QVector<Bucket>& lower = _levels[level-1];
+        QVector<Bucket>& upper = _levels[level];
+        int ratio = int(Resolutions[level] / Resolutions[level-1]);
+        for (int i = 0; i < lower.size(); i++)
+        {
+            const Bucket& src = lower.at(i);
+            Bucket& dst = upper[i / ratio];
+            for (int t = 0; t < LogItem::TypeCount; t++)
+                dst.counts[t] += src.counts[t];
+        }
+    }
+}
+
+int TimeHistogram::bucketAt(int level, qint64 time) const
+{
+    return int(floorDiv(time - _start, Resolutions[level]));
+}
+
+int TimeHistogram::levelFor(qint64 from, qint64 to, int maxBuckets) const
+{
+    for (int level = _finest; level < LevelCount; level++)
+        if ((to - from) / Resolutions[level] <= maxBuckets)
+            return level;
+    return LevelCount-1;
+}
+
+QVector<TimeHistogram::Interval> TimeHistogram::bursts(int level, qint64 from, qint64 to, double sigmas) const
+{
+    QVector<Interval> res;
+    const QVector<Bucket>& buckets = _levels[level];
+    int i0 = qMax(0, bucketAt(level, qMax(from, _firstTime)));
+    int i1 = qMin(buckets.size(), bucketAt(level, qMin(to, _lastTime)) + 1);
+    if (i1 - i0 < 2) return res;
+
+    double sum = 0, sum2 = 0;
+    for (int i = i0; i < i1; i++)
+    {
+        double total = buckets.at(i).total();
+        sum += total;
+        sum2 += total * total;
+    }
+    double mean = sum / (i1 - i0);
+    double sd = qSqrt(qMax(0.0, sum2 / (i1 - i0) - mean * mean));
+    if (sd <= 0) return res;
+
+    double threshold = mean + sigmas * sd;
+    qint64 step = Resolutions[level];
+    for (int i = i0; i < i1; i++)
+    {
+        if (buckets.at(i).total() <= threshold) continue;
+        int j = i;
+        while (j < i1 && buckets.at(j).total() > threshold) j++;
+        res.append({ _start + i * step, _start + j * step });
+        i = j;
+    }
+    return res;
+}
+
+QVector<TimeHistogram::Interval> TimeHistogram::gaps(int level, qint64 from, qint64 to, int minBuckets) const
+{
+    QVector<Interval> res;
+    const QVector<Bucket>& buckets = _levels[level];
+    // Empty buckets before the first and after the last record are not gaps
+    int i0 = qMax(0, bucketAt(level, qMax(from, _firstTime)));
+    int i1 = qMin(buckets.size(), bucketAt(level, qMin(to, _lastTime)) + 1);
+
+    qint64 step = Resolutions[level];
+    for (int i = i0; i < i1; i++)
+    {
+        if (buckets.at(i).total() > 0) continue;
+        int j = i;
+        while (j < i1 && buckets.at(j).total() == 0) j++;
+        if (j - i >= minBuckets)
+            res.append({ _start + i * step, _start + j * step });
+        i = j;
+    }
+    return res;
+}
+
+qint64 TimeHistogram::memoryUsage() const
+{
+    qint64 bytes = 0;
+    for (const auto& level : _levels)
+        bytes += level.capacity() * qint64(sizeof(Bucket));
+    bytes += _runs.capacity() * qint64(sizeof(Run));
+    return bytes;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void VisibleTimeHistogram::update(const TimeHistogram* all, const LogView& view)
+{
+    if (!all || !view.base())
+    {
+        clear();
+        return;
+    }
+    if (view.isAll())
+    {
+        TimeHistogram::operator=(*all);
+        return;
+    }
+
+    clear();
+    _start = all->_start;
+    _firstTime = all->_firstTime;
+    _lastTime = all->_lastTime;
+    _finest = all->_finest;
+    for (int level = _finest; level < LevelCount; level++)
+        _levels[level].resize(all->_levels[level].size());
+
+    RecordBits visible(all->_recordCount);
+    for (int i = 0; i < view.count(); i++)
+    {
+        int index = view.indexAt(i);
+        if (index < all->_recordCount)
+            visible.setBit(index);
+    }
+
+    QVector<Bucket>& finest = _levels[_finest];
+    const QVector<Run>& runs = all->_runs;
+    for (int r = 0; r < runs.size(); r++)
+    {
+        const Run& run = runs.at(r);
+        int end = r+1 < runs.size() ? runs.at(r+1).first : all->_recordCount;
+        int n = visible.count(run.first, end);
+        if (n == 0) continue;
+        if (run.second == LogItem::NoTime)
+            _untimed += n;
+        else
+            finest[int((run.second - _start) / Resolutions[_finest])].counts[run.type] += n;
+    }
+    sumLevels();
+}
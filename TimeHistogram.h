@@ -0,0 +1,104 @@
+#ifndef TIME_HISTOGRAM_H
+#define TIME_HISTOGRAM_H
+
+#include <QVector>
+
+#include "LogItem.h"
+
+/**
+    Record counts per time bucket, split by record type, precomputed at several resolutions
+    from one second to one week. Any time range can be displayed by picking the level
+    with a suitable bucket count, without going through the records again.
+
+    Records are appended while they are parsed, buckets grow to cover their times.
+    Runs of consecutive records of the same second and type are remembered,
+    so counts of any subset of records are taken from a bit set of their indexes.
+*/
+class TimeHistogram
+{
+public:
+    struct Bucket
+    {
+        int counts[LogItem::TypeCount] = {};
+        int total() const;
+    };
+
+    struct Interval
+    {
+        qint64 start, end;
+    };
+
+    enum { LevelCount = 8 };
+    static qint64 resolution(int level);
+
+    /// Counts the record, its index must follow the index of the previously appended one.
+    void append(const LogItem* item);
+
+    /// Uncounts the first records, indexes of the rest are shifted down by the count.
+    /// Buckets before the remaining records are dropped.
+    void removeFirst(int count);
+
+    void clear();
+
+    bool isEmpty() const { return _levels[LevelCount-1].isEmpty(); }
+    qint64 startTime() const { return _start; }
+    qint64 endTime() const { return _start + _levels[LevelCount-1].size() * resolution(LevelCount-1); }
+    qint64 firstTime() const { return _firstTime; }
+    qint64 lastTime() const { return _lastTime; }
+    int finestLevel() const { return _finest; }
+    int untimedCount() const { return _untimed; }
+
+    int bucketCount(int level) const { return _levels[level].size(); }
+    const Bucket& bucket(int level, int i) const { return _levels[level].at(i); }
+    int bucketAt(int level, qint64 time) const;
+
+    /// Finest level showing the time range in no more than maxBuckets buckets.
+    int levelFor(qint64 from, qint64 to, int maxBuckets) const;
+
+    /// Runs of buckets with counts far above the mean of the range.
+    QVector<Interval> bursts(int level, qint64 from, qint64 to, double sigmas = 3) const;
+
+    /// Runs of empty buckets lasting at least minBuckets.
+    QVector<Interval> gaps(int level, qint64 from, qint64 to, int minBuckets = 3) const;
+
+    qint64 memoryUsage() const;
+
+private:
+    /// Consecutive records having the same type and the same second, the run lasts until the next one.
+    struct Run
+    {
+        qint64 second; ///< start of the second or LogItem::NoTime
+        int first;
+        LogItem::Type type;
+    };
+
+    qint64 _start = 0;
+    qint64 _firstTime = 0, _lastTime = 0;
+    int _finest = 0;
+    int _untimed = 0;
+    QVector<Bucket> _levels[LevelCount];
+    QVector<Run> _runs;
+    int _recordCount = 0;
+
+    void cover(qint64 time);
+    void trimStart();
+    void addCount(LogItem::Type type, qint64 time, int delta);
+    void sumLevels();
+
+    friend class VisibleTimeHistogram;
+};
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+    Histogram of the records passing filters. It has buckets of the histogram of all records,
+    counts of the finest buckets are taken as numbers of visible records in runs of that
+    histogram, so records themselves are not visited when the filter changes.
+*/
+class VisibleTimeHistogram : public TimeHistogram
+{
+public:
+    void update(const TimeHistogram* all, const LogView& view);
+};
+
+#endif // TIME_HISTOGRAM_H
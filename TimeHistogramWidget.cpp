@@ -0,0 +1,206 @@
+#include "TimeHistogramWidget.h"
+#include "TimeHistogram.h"
+#include "Appearance.h"
+
+#include <QApplication>
+#include <QDateTime>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QToolTip>
+#include <QWheelEvent>
+
+namespace {
+
+const qint64 MinSpan = 1000;
+
+QString formatTime(qint64 time)
+{
+    return QDateTime::fromMSecsSinceEpoch(time, Qt::UTC).toString("dd.MM.yyyy hh:mm:ss");
+}
+
+QString formatResolution(qint64 msecs)
+{
+    if (msecs < 60 * 1000) return qApp->tr("%1 s").arg(msecs / 1000);
+    if (msecs < 3600 * 1000) return qApp->tr("%1 min").arg(msecs / 60000);
+    if (msecs < 24 * 3600 * 1000) return qApp->tr("%1 h").arg(msecs / 3600000);
+    return qApp->tr("%1 d").arg(msecs / (24 * 3600000));
+}
+
+QColor typeColor(int type)
+{
+    switch (LogItem::Type(type))
+    {
+    case LogItem::Info: return QColor(70, 130, 180);
+    case LogItem::Warning: { QColor c = Appearance::colorWarning(); c.setAlpha(255); return c; }
+    case LogItem::Error: { QColor c = Appearance::colorError(); c.setAlpha(255); return c; }
+    case LogItem::Debug: return QColor(160, 160, 160);
+    }
+    return Qt::black;
+}
+
+} // namespace
+
+TimeHistogramWidget::TimeHistogramWidget(const TimeHistogram* histogram, QWidget *parent)
+    : QWidget(parent), _histogram(histogram)
+{
+    setMouseTracking(true);
+    setMinimumHeight(150);
+    resetZoom();
+}
+
+void TimeHistogramWidget::resetZoom()
+{
+    if (_histogram->isEmpty()) return;
+    setRange(_histogram->firstTime(), _histogram->lastTime() + 1000);
+}
+
+void TimeHistogramWidget::setRange(qint64 from, qint64 to)
+{
+    if (_histogram->isEmpty()) return;
+
+    qint64 minTime = _histogram->startTime();
+    qint64 maxTime = _histogram->endTime();
+    qint64 span = qBound(MinSpan, to - from, maxTime - minTime);
+    from = qBound(minTime, from, maxTime - span);
+    _from = from;
+    _to = from + span;
+    update();
+}
+
+QRect TimeHistogramWidget::plotRect() const
+{
+    int textHeight = fontMetrics().height();
+    return rect().adjusted(8, textHeight + 12, -8, -textHeight - 8);
+}
+
+qint64 TimeHistogramWidget::timeAt(int x) const
+{
+    QRect r = plotRect();
+    return _from + qint64(double(x - r.left()) / qMax(1, r.width()) * (_to - _from));
+}
+
+int TimeHistogramWidget::xAt(qint64 time) const
+{
+    QRect r = plotRect();
+    return r.left() + int(double(time - _from) / (_to - _from) * r.width());
+}
+
+void TimeHistogramWidget::paintEvent(QPaintEvent*)
+{
+    QPainter p(this);
+    p.fillRect(rect(), palette().base());
+
+    if (_histogram->isEmpty())
+    {
+        p.drawText(rect(), Qt::AlignCenter, tr("There are no records with recognized moments"));
+        return;
+    }
+
+    QRect r = plotRect();
+    int level = _histogram->levelFor(_from, _to, qMax(1, r.width()));
+    qint64 step = TimeHistogram::resolution(level);
+    int i0 = qMax(0, _histogram->bucketAt(level, _from));
+    int i1 = qMin(_histogram->bucketCount(level), _histogram->bucketAt(level, _to) + 1);
+
+    int maxTotal = 1;
+    for (int i = i0; i < i1; i++)
+        maxTotal = qMax(maxTotal, _histogram->bucket(level, i).total());
+
+    auto gaps = _histogram->gaps(level, _from, _to);
+    for (const auto& gap : gaps)
+        p.fillRect(QRect(QPoint(xAt(gap.start), r.top()), QPoint(xAt(gap.end), r.bottom())), QColor(0, 0, 0, 20));
+
+    for (int i = i0; i < i1; i++)
+    {
+        const auto& bucket = _histogram->bucket(level, i);
+        qint64 start = _histogram->startTime() + i * step;
+        int x0 = xAt(start);
+        int w = qMax(1, xAt(start + step) - x0);
+        int y = r.bottom();
+        for (int t = 0; t < LogItem::TypeCount; t++)
+        {
+            int h = int(double(bucket.counts[t]) / maxTotal * r.height());
+            if (h <= 0) continue;
+            p.fillRect(x0, y - h + 1, w, h, typeColor(t));
+            y -= h;
+        }
+    }
+
+    auto bursts = _histogram->bursts(level, _from, _to);
+    p.setPen(Qt::NoPen);
+    p.setBrush(Qt::red);
+    for (const auto& burst : bursts)
+    {
+        int x0 = xAt(burst.start);
+        int x1 = qMax(x0 + 2, xAt(burst.end));
+        p.drawRect(x0, r.top() - 5, x1 - x0, 3);
+    }
+
+    p.setPen(palette().color(QPalette::Text));
+    p.drawLine(r.bottomLeft(), r.bottomRight());
+    int textHeight = fontMetrics().height();
+    QRect axis(r.left(), r.bottom() + 4, r.width(), textHeight);
+    p.drawText(axis, Qt::AlignLeft, formatTime(_from));
+    p.drawText(axis, Qt::AlignRight, formatTime(_to));
+    p.drawText(QRect(r.left(), 4, r.width(), textHeight), Qt::AlignLeft,
+               tr("Bucket: %1; max: %2; bursts: %3; gaps: %4")
+               .arg(formatResolution(step)).arg(maxTotal).arg(bursts.size()).arg(gaps.size()));
+}
+
+void TimeHistogramWidget::wheelEvent(QWheelEvent* event)
+{
+    if (_histogram->isEmpty()) return;
+
+    double factor = event->angleDelta().y() > 0 ? 0.8 : 1.25;
+    qint64 center = timeAt(event->pos().x());
+    qint64 from = center - qint64((center - _from) * factor);
+    qint64 to = center + qint64((_to - center) * factor);
+    setRange(from, to);
+    event->accept();
+}
+
+void TimeHistogramWidget::mousePressEvent(QMouseEvent* event)
+{
+    if (event->button() != Qt::LeftButton) return;
+    _dragging = true;
+    _dragX = event->pos().x();
+    _dragFrom = _from;
+}
+
+void TimeHistogramWidget::mouseMoveEvent(QMouseEvent* event)
+{
+    if (!_dragging)
+    {
+        showBucketTip(event->pos());
+        return;
+    }
+    qint64 span = _to - _from;
+    qint64 shift = qint64(double(_dragX - event->pos().x()) / qMax(1, plotRect().width()) * span);
+    setRange(_dragFrom + shift, _dragFrom + shift + span);
+}
+
+void TimeHistogramWidget::mouseReleaseEvent(QMouseEvent*)
+{
+    _dragging = false;
+}
+
+void TimeHistogramWidget::mouseDoubleClickEvent(QMouseEvent*)
+{
+    resetZoom();
+}
+
+void TimeHistogramWidget::showBucketTip(const QPoint& pos)
+{
+    if (_histogram->isEmpty() || !plotRect().contains(pos)) return;
+
+    int level = _histogram->levelFor(_from, _to, qMax(1, plotRect().width()));
+    int i = _histogram->bucketAt(level, timeAt(pos.x()));
+    if (i < 0 || i >= _histogram->bucketCount(level)) return;
+
+    const auto& bucket = _histogram->bucket(level, i);
+    qint64 start = _histogram->startTime() + i * TimeHistogram::resolution(level);
+    QToolTip::showText(mapToGlobal(pos), tr("%1\nInfo: %2\nWarning: %3\nError: %4\nDebug: %5")
+        .arg(formatTime(start))
+        .arg(bucket.counts[LogItem::Info]).arg(bucket.counts[LogItem::Warning])
+        .arg(bucket.counts[LogItem::Error]).arg(bucket.counts[LogItem::Debug]), this);
+}
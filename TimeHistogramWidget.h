@@ -0,0 +1,44 @@
+#ifndef TIME_HISTOGRAM_WIDGET_H
+#define TIME_HISTOGRAM_WIDGET_H
+
+#include <QWidget>
+
+class TimeHistogram;
+
+/**
+    Plots record counts over time. The wheel zooms around the cursor, dragging pans,
+    double click shows the whole time range. Bursts are marked above the bars
+    and gaps are shaded.
+*/
+class TimeHistogramWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit TimeHistogramWidget(const TimeHistogram* histogram, QWidget *parent = 0);
+
+    void resetZoom();
+
+protected:
+    void paintEvent(QPaintEvent*) override;
+    void wheelEvent(QWheelEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+    void mouseMoveEvent(QMouseEvent* event) override;
+    void mouseReleaseEvent(QMouseEvent* event) override;
+    void mouseDoubleClickEvent(QMouseEvent* event) override;
+
+private:
+    const TimeHistogram* _histogram;
+    qint64 _from = 0, _to = 0;
+    bool _dragging = false;
+    int _dragX = 0;
+    qint64 _dragFrom = 0;
+
+    QRect plotRect() const;
+    qint64 timeAt(int x) const;
+    int xAt(qint64 time) const;
+    void setRange(qint64 from, qint64 to);
+    void showBucketTip(const QPoint& pos);
+};
+
+#endif // TIME_HISTOGRAM_WIDGET_H
@@ -1,4 +1,4 @@
-QT += core gui
+QT += core gui concurrent network
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
 include($$_PRO_FILE_PWD_/orion/orion.pri)
@@ -8,25 +8,73 @@ TEMPLATE = app
 
 SOURCES += main.cpp\
     Appearance.cpp \
+    FileScanner.cpp \
+    LineScanner.cpp \
     MainWindow.cpp \
+    LogExporter.cpp \
+    LogFields.cpp \
+    LogIngest.cpp \
     LogItem.cpp \
     LogProcessor.cpp \
     LogTableWidget.cpp \
     LogFilterPanel.cpp \
+    LogFindBar.cpp \
     LogItemWidget.cpp \
+    LogPatterns.cpp \
+    LogQuery.cpp \
+    LogPatternsWidget.cpp \
+    LogRelatedWidget.cpp \
+    LogSearch.cpp \
+    LogSorter.cpp \
+    LogTextSource.cpp \
+    LogTextView.cpp \
+    MemoryPanel.cpp \
     OpenFilesDialog.cpp \
-    RegexExamWindow.cpp
+    PerfCounters.cpp \
+    PerformancePanel.cpp \
+    RecordBits.cpp \
+    RegexPrefilter.cpp \
+    RegexExamWindow.cpp \
+    StringPool.cpp \
+    TextDecoder.cpp \
+    TimeHistogram.cpp \
+    TimeHistogramWidget.cpp
 
 HEADERS  += \
     Appearance.h \
+    FileScanner.h \
+    LineScanner.h \
     MainWindow.h \
+    LogExporter.h \
+    LogFields.h \
+    LogIngest.h \
     LogItem.h \
     LogProcessor.h \
     LogTableWidget.h \
     LogFilterPanel.h \
+    LogFindBar.h \
     LogItemWidget.h \
+    LogPatterns.h \
+    LogQuery.h \
+    LogPatternsWidget.h \
+    LogRelatedWidget.h \
+    LogSearch.h \
+    LogSorter.h \
+    LogTextSource.h \
+    LogTextView.h \
+    MemoryPanel.h \
     OpenFilesDialog.h \
-    RegexExamWindow.h
+    PerfCounters.h \
+    PerformancePanel.h \
+    RecordBits.h \
+    RegexPrefilter.h \
+    RegexExamWindow.h \
+    Simd.h \
+    SpscQueue.h \
+    StringPool.h \
+    TextDecoder.h \
+    TimeHistogram.h \
+    TimeHistogramWidget.h
 
 DESTDIR = $$_PRO_FILE_PWD_/bin
 